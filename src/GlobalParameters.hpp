@@ -40,11 +40,19 @@ namespace GP
 	{
 		inline constexpr int BOXES_PER_SIDE{ 35 };
 
+		/*
+		  Maximum distance, in boxes, between the boxes of two overlapping rods.
+		  REACH = 1 keeps boxes wider than a rod diagonal. Finer grids (e.g. BOXES_PER_SIDE = 71, REACH = 2 or 107, 3)
+		  have smaller boxes and larger stencils, whose candidates are closer to the true interaction set.
+		*/
+		inline constexpr int REACH{ 1 };
+
 		// Parity requirement
-		static_assert(BOXES_PER_SIDE > 1);
+		static_assert(BOXES_PER_SIDE > 2 * REACH);
 		static_assert(BOXES_PER_SIDE % 2 == 1);
-		// Box width > Rod diagonal
-		static_assert(4.0 * CELL::R_OUT * CELL::R_OUT > (BOXES_PER_SIDE - 2) * (BOXES_PER_SIDE - 2) * (ROD::W * ROD::W + ROD::L * ROD::L));
+		static_assert(REACH >= 1);
+		// REACH * Box width > Rod diagonal
+		static_assert(4.0 * CELL::R_OUT * CELL::R_OUT * REACH * REACH > (BOXES_PER_SIDE - 2 * REACH) * (BOXES_PER_SIDE - 2 * REACH) * (ROD::W * ROD::W + ROD::L * ROD::L));
 	}
 
 	namespace MC
@@ -55,16 +63,103 @@ namespace GP
 		inline constexpr int THERMAL_STEPS{ 1'000'000 };
 		inline constexpr int MC_STEPS{ 10'000 };
 		inline constexpr int MC_ITERATIONS{ 24 }; // Number of repetitions of MC_STEPS
+		inline constexpr int SNAPSHOT_INTERVAL{ 100 }; // MC steps between snapshots for live analysis
+
+		/*
+		  Equilibration detection (AnnularCell::equilibrate):
+		  Observables are sampled every THERMAL_SAMPLE_INTERVAL steps, and checked every THERMAL_WINDOW samples.
+		  Each check fits a straight line to the second half of the samples, the first half being discarded as transient.
+		  The slope error is scaled by the integrated autocorrelation time of the residuals, summed up to
+		  THERMAL_SOKAL_C times itself (Sokal's window), as successive samples are far from independent.
+		  A check passes when no observable has a slope significant at THERMAL_ALPHA (Bonferroni corrected
+		  over the observables), and each spans at least THERMAL_MIN_EFFECTIVE independent samples.
+		  Thermalization stops once THERMAL_PATIENCE consecutive checks pass,
+		  but never before THERMAL_MIN_STEPS nor after THERMAL_STEPS.
+		*/
+		inline constexpr int THERMAL_MIN_STEPS{ 50'000 };
+		inline constexpr int THERMAL_SAMPLE_INTERVAL{ 100 };
+		inline constexpr int THERMAL_WINDOW{ 100 };
+		inline constexpr double THERMAL_ALPHA{ 0.05 };
+		inline constexpr double THERMAL_SOKAL_C{ 5.0 };
+		inline constexpr double THERMAL_MIN_EFFECTIVE{ 20.0 };
+		inline constexpr int THERMAL_PATIENCE{ 2 };
+
+		// Equilibration detection requirements
+		static_assert(THERMAL_MIN_STEPS <= THERMAL_STEPS);
+		static_assert(THERMAL_SAMPLE_INTERVAL > 0);
+		static_assert(THERMAL_WINDOW > 2); // A line fit to fewer points has no error estimate
+		static_assert(THERMAL_ALPHA > 0.0 && THERMAL_ALPHA < 1.0);
+		static_assert(THERMAL_SOKAL_C > 0.0);
+		static_assert(THERMAL_MIN_EFFECTIVE > 0.0);
+		static_assert(THERMAL_PATIENCE > 0);
+	}
+
+	namespace PRESSURE
+	{
+		/*
+		  Virtual compressions of the pressure estimator (AnnularCell::samplePressure):
+		  relative shrink of every rod separation for the bulk, and displacement of each wall towards the rods.
+		  The estimates are biased by O(EPSILON) and O(DR_WALL), and become noisier as these decrease.
+		  Counts are sampled every SAMPLE_INTERVAL MC steps during AnnularCell::MCSimulation.
+		*/
+		inline constexpr double EPSILON{ 5e-4 };
+		inline constexpr double DR_WALL{ 1e-3 * ROD::W };
+		inline constexpr int SAMPLE_INTERVAL{ 100 };
+
+		// Compression requirements
+		static_assert(EPSILON > 0.0);
+		static_assert(EPSILON < 1.0);
+		static_assert(DR_WALL > 0.0);
+		static_assert(CELL::R_IN + DR_WALL < CELL::R_OUT - DR_WALL);
+		static_assert(SAMPLE_INTERVAL > 0);
+		// Pairs overlapping after the compression are within the grid stencil
+		static_assert(4.0 * CELL::R_OUT * CELL::R_OUT * GRID::REACH * GRID::REACH * (1.0 - EPSILON) * (1.0 - EPSILON)
+			> (GRID::BOXES_PER_SIDE - 2 * GRID::REACH) * (GRID::BOXES_PER_SIDE - 2 * GRID::REACH) * (ROD::W * ROD::W + ROD::L * ROD::L));
 	}
 
 	namespace IO
 	{
 		inline const std::filesystem::path INITIAL{ "intial_configuration.csv" };
 		inline const std::filesystem::path THERMALIZED{ "thermalized_configuration.csv" };
+		inline const std::filesystem::path THERMAL_LOG{ "thermalization_log.csv" };
 		inline const std::filesystem::path MC_BASE{ "configuration_" };
 		inline const std::filesystem::path MC_EXT{ ".csv" };
 	}
 
+	namespace FIELD
+	{
+		/*
+		  Polar (r, theta) mesh of the coarse-grained director field over R_IN..R_OUT,
+		  and number of MC steps between saved frames
+		*/
+		inline constexpr int R_BINS{ 10 };
+		inline constexpr int THETA_BINS{ 64 };
+		inline constexpr int SAVE_INTERVAL{ 100 };
+		inline const std::filesystem::path FILENAME{ "director_field.bin" };
+
+		// Mesh requirements
+		static_assert(R_BINS > 0);
+		static_assert(THETA_BINS > 0);
+		static_assert(SAVE_INTERVAL > 0);
+	}
+
+	namespace TRAJECTORY
+	{
+		/*
+		  Archival trajectories: frames between keyframes, and maximum error
+		  of positions and angles in lossy mode
+		*/
+		inline constexpr int KEYFRAME_INTERVAL{ 100 };
+		inline constexpr double PRECISION_XY{ 1e-5 * ROD::W };
+		inline constexpr double PRECISION_A{ 1e-5 };
+		inline const std::filesystem::path FILENAME{ "trajectory.actr" };
+
+		// Trajectory requirements
+		static_assert(KEYFRAME_INTERVAL > 0);
+		static_assert(PRECISION_XY > 0.0);
+		static_assert(PRECISION_A > 0.0);
+	}
+
 	namespace ANALYSIS
 	{
 		/*
@@ -76,6 +171,34 @@ namespace GP
 		  Expected inverse distance between smectic layers
 		*/
 		inline constexpr double Q{ 1.0 / (1.01 * ROD::L) };
+
+		/*
+		  Cutoff distance and number of radial bins of the correlation functions
+		*/
+		inline constexpr double R_CORR{ 8.0 * ROD::L };
+		inline constexpr int CORR_BINS{ 320 };
+
+		// Cutoff requirements
+		static_assert(R_CORR > 0.0);
+		static_assert(R_CORR < 2.0 * CELL::R_OUT);
+		static_assert(CORR_BINS > 0);
+
+		/*
+		  Domain detection: minimum local order parameters of each phase, distance below which
+		  two rods are adjacent and maximum misalignment of their local directors within a domain
+		*/
+		inline constexpr double Q2_MIN{ 0.7 };
+		inline constexpr double Q4_MIN{ 0.7 };
+		inline constexpr double QS_MIN{ 0.5 };
+		inline constexpr double R_ADJ{ 1.5 * ROD::L };
+		inline constexpr double DA_MAX{ 0.1 * std::numbers::pi };
+
+		/*
+		  Defect detection: width of the boxes around which the winding of the director field
+		  is computed, and minimum order within a box for its director to be used
+		*/
+		inline constexpr double DEFECT_BOX_W{ 2.0 * ROD::L };
+		inline constexpr double DEFECT_Q_MIN{ 0.3 };
 	}
 }
 
@@ -110,8 +233,11 @@ namespace GP
 		inline constexpr int NUM_BOXES{ BOXES_PER_SIDE * BOXES_PER_SIDE };
 		inline constexpr int CENTRAL_BOX{ (BOXES_PER_SIDE - 1) / 2 };
 		inline constexpr int CENTRAL_INDEX{ (NUM_BOXES - 1) / 2};
-		inline constexpr double BOX_W{ 2.0 * CELL::R_OUT / (BOXES_PER_SIDE - 2) }; // There is an empty, 1-box-wide frame
+		inline constexpr double BOX_W{ 2.0 * CELL::R_OUT / (BOXES_PER_SIDE - 2 * REACH) }; // There is an empty, REACH-box-wide frame
 		inline constexpr double BOX_INV_W{ 1.0 / BOX_W };
+		inline constexpr double HALF_BOX_W{ 0.5 * BOX_W };
+		inline constexpr int STENCIL_SIDE{ 2 * REACH + 1 };
+		inline constexpr int STENCIL_SIZE{ STENCIL_SIDE * STENCIL_SIDE };
 	}
 
 	namespace CHECKS
@@ -135,4 +261,31 @@ namespace GP
 		inline const	 double MIN_AUX_ANGLE{ std::atan2(GP::ROD::HALF_W, GP::CHECKS::R_IN_PLUS_HALF_L) }; // Constexpr in C++26
 		inline const	 double MAX_AUX_ANGLE{ std::atan2(GP::CHECKS::R_IN_PLUS_HALF_W, GP::ROD::HALF_L) }; // Constexpr in C++26
 	}
+
+	namespace PRESSURE
+	{
+		inline constexpr double SCALE{ 1.0 - EPSILON };
+		inline const double CONTACT_D{ ROD::D / SCALE }; // Constexpr in C++26
+		inline const double CONTACT_D_SQ{ CONTACT_D * CONTACT_D }; // Constexpr in C++26
+
+		inline constexpr double AREA{ std::numbers::pi * (CELL::R_OUT_SQ - CELL::R_IN_SQ) };
+		inline constexpr double DENSITY{ NUM_RODS / AREA };
+		inline constexpr double DA_BULK{ AREA * (1.0 - SCALE * SCALE) };
+		inline constexpr double DA_OUTER{ std::numbers::pi * (CELL::R_OUT_SQ - (CELL::R_OUT - DR_WALL) * (CELL::R_OUT - DR_WALL)) };
+		inline constexpr double DA_INNER{ std::numbers::pi * ((CELL::R_IN + DR_WALL) * (CELL::R_IN + DR_WALL) - CELL::R_IN_SQ) };
+
+		inline constexpr double OUTER_SQ{ (CELL::R_OUT - DR_WALL) * (CELL::R_OUT - DR_WALL) };
+		inline constexpr double INNER_SQ{ (CELL::R_IN + DR_WALL) * (CELL::R_IN + DR_WALL) };
+		inline const     double OUTER_CANDIDATE_SQ{ (CELL::R_OUT - DR_WALL - ROD::HALF_D) * (CELL::R_OUT - DR_WALL - ROD::HALF_D) }; // Constexpr in C++26
+		inline const     double INNER_CANDIDATE_SQ{ (CELL::R_IN + DR_WALL + ROD::HALF_D) * (CELL::R_IN + DR_WALL + ROD::HALF_D) }; // Constexpr in C++26
+	}
+
+	namespace ANALYSIS
+	{
+		inline constexpr double R_CORR_SQ{ R_CORR * R_CORR };
+		inline constexpr double CORR_BIN_W{ R_CORR / CORR_BINS };
+		inline constexpr double CORR_BIN_INV_W{ 1.0 / CORR_BIN_W };
+		inline const double R{ std::sqrt(R_SQ) }; // Constexpr in C++26
+		inline constexpr double R_ADJ_SQ{ R_ADJ * R_ADJ };
+	}
 }
@@ -1,14 +1,38 @@
 #include "analysis.hpp"
+#include "cellList.hpp"
 #include <ranges>
 #include <algorithm>
 #include <utility>
+#include <numeric>
+#include <limits>
 #include <fstream>
+#include <iomanip>
 #include <iostream>
 
 auto Analysis::analize(const std::filesystem::path& file_in, const std::filesystem::path& file_out) -> void
 {
-    cell.fillFromFile(file_in);
+    if (!cell.fillFromFile(file_in))
+    {
+        std::cout << "ANALYSIS OF " << file_in << " SKIPPED!\n";
+        return;
+    }
+    save(file_out);
+}
+
+auto Analysis::analize(TrajectoryReader& trajectory, const std::filesystem::path& file_out) -> bool
+{
+    std::array<Rod, GP::NUM_RODS> rods{};
+    if (!trajectory.read(rods))
+    {
+        return false;
+    }
+    cell.fillFromRods(rods);
+    save(file_out);
+    return true;
+}
 
+auto Analysis::save(const std::filesystem::path& file_out) const -> void
+{
     std::ofstream of(file_out);
     if (of.is_open())
     {
@@ -26,24 +50,33 @@ auto Analysis::analize(const std::filesystem::path& file_in, const std::filesyst
         }
         of.close();
     }
+    else
+    {
+        std::cout << "FILE " << file_out << " COULD NOT BE OPENED!\n";
+    }
 }
 
 [[nodiscard]] auto Analysis::getRegions() const -> std::vector<std::forward_list<int>>
 {
     std::vector<std::forward_list<int>> regions{ GP::NUM_RODS };
 
+    CellList cells{ GP::ANALYSIS::R };
+    cells.build(cell.getRods());
     for (int i = 0; i < GP::NUM_RODS; ++i)
     {
         const Rod& ref = cell.getRod(i);
-        for (int j = 0; j <= i; ++j)
-        {
-            const Rod& rod = cell.getRod(j);
-            if ((rod.x - ref.x) * (rod.x - ref.x) + (rod.y - ref.y) * (rod.y - ref.y) < GP::ANALYSIS::R_SQ)
+        cells.forEachCandidate(i, [&](const int j)
             {
-                regions[i].push_front(j);
-                regions[j].push_front(i);
-            }
-        }
+                const Rod& rod = cell.getRod(j);
+                if (j <= i && (rod.x - ref.x) * (rod.x - ref.x) + (rod.y - ref.y) * (rod.y - ref.y) < GP::ANALYSIS::R_SQ)
+                {
+                    regions[i].push_front(j);
+                    if (j != i)
+                    {
+                        regions[j].push_front(i);
+                    }
+                }
+            });
     }
 
     return regions;
@@ -51,8 +84,7 @@ auto Analysis::analize(const std::filesystem::path& file_in, const std::filesyst
 
 [[nodiscard]] auto Analysis::computeLocalDirectors() const -> std::vector<double>
 {
-    std::vector<double> directors{};
-    directors.reserve(GP::NUM_RODS);
+    std::vector<double> directors(GP::NUM_RODS);
 
     const std::vector<std::forward_list<int>> regions = getRegions();
     for (int i = 0; i < GP::NUM_RODS; ++i)
@@ -77,7 +109,7 @@ auto Analysis::analize(const std::filesystem::path& file_in, const std::filesyst
     const auto dir = computeLocalDirectors();
     const auto regions = getRegions();
 
-    std::vector<double> q2{ GP::NUM_RODS };
+    std::vector<double> q2(GP::NUM_RODS);
     for (int i = 0; i < GP::NUM_RODS; ++i)
     {
         int size = 0;
@@ -97,13 +129,14 @@ auto Analysis::analize(const std::filesystem::path& file_in, const std::filesyst
     const auto dir = computeLocalDirectors();
     const auto regions = getRegions();
 
-    std::vector<double> q4{ GP::NUM_RODS };
+    std::vector<double> q4(GP::NUM_RODS);
     for (int i = 0; i < GP::NUM_RODS; ++i)
     {
         int size = 0;
         for (const int j : regions[i])
         {
             q4[i] += std::cos(4.0 * (cell.getRod(j).a - dir[i]));
+            ++size;
         }
         q4[i] /= size;
     }
@@ -117,7 +150,7 @@ auto Analysis::analize(const std::filesystem::path& file_in, const std::filesyst
     const auto regions = getRegions();
 
     constexpr double K = 2.0 * std::numbers::pi * GP::ANALYSIS::Q;
-    std::vector<double> qS{ GP::NUM_RODS };
+    std::vector<double> qS(GP::NUM_RODS);
     for (int i = 0; i < GP::NUM_RODS; ++i)
     {
         int size{ 0 };
@@ -143,7 +176,7 @@ auto Analysis::analize(const std::filesystem::path& file_in, const std::filesyst
     const auto regions = getRegions();
     constexpr double K = 2.0 * std::numbers::pi * GP::ANALYSIS::Q;
 
-    std::vector<Params> params{ GP::NUM_RODS };
+    std::vector<Params> params(GP::NUM_RODS);
     for (int i = 0; i < GP::NUM_RODS; ++i)
     {
         int size{ 0 };
@@ -168,3 +201,208 @@ auto Analysis::analize(const std::filesystem::path& file_in, const std::filesyst
 
     return params;
 }
+
+// Union-find with path halving and union by size
+class DisjointSets
+{
+public:
+    explicit DisjointSets(const int n) : m_parent(n), m_size(n, 1)
+    {
+        std::iota(m_parent.begin(), m_parent.end(), 0);
+    }
+
+    [[nodiscard]] auto find(int i) -> int
+    {
+        while (m_parent[i] != i)
+        {
+            m_parent[i] = m_parent[m_parent[i]];
+            i = m_parent[i];
+        }
+        return i;
+    }
+
+    auto unite(int i, int j) -> void
+    {
+        i = find(i);
+        j = find(j);
+        if (i != j)
+        {
+            if (m_size[i] < m_size[j])
+            {
+                std::swap(i, j);
+            }
+            m_parent[j] = i;
+            m_size[i] += m_size[j];
+        }
+    }
+
+private:
+    std::vector<int> m_parent;
+    std::vector<int> m_size;
+};
+
+inline static auto classify(const Params& p) -> Phase
+{
+    if (p.q2 > GP::ANALYSIS::Q2_MIN)
+    {
+        return (p.qS > GP::ANALYSIS::QS_MIN) ? Phase::SMECTIC : Phase::NEMATIC;
+    }
+    return (p.q4 > GP::ANALYSIS::Q4_MIN) ? Phase::TETRATIC : Phase::DISORDERED;
+}
+
+[[nodiscard]] auto Analysis::findDomains(const std::vector<double>& dirs, const std::vector<Params>& params) const -> Domains
+{
+    Domains domains{ std::vector<Phase>(GP::NUM_RODS), std::vector<int>(GP::NUM_RODS, -1), std::vector<bool>(GP::NUM_RODS, false), 0 };
+    std::ranges::transform(params, domains.phase.begin(), classify);
+
+    CellList cells{ GP::ANALYSIS::R_ADJ };
+    cells.build(cell.getRods());
+    const auto forEachAdjacent = [&](const int i, auto&& f) {
+        const Rod& ref = cell.getRod(i);
+        cells.forEachCandidate(i, [&](const int j)
+            {
+                const Rod& rod = cell.getRod(j);
+                if (j != i && (rod.x - ref.x) * (rod.x - ref.x) + (rod.y - ref.y) * (rod.y - ref.y) < GP::ANALYSIS::R_ADJ_SQ)
+                {
+                    f(j);
+                }
+            });
+    };
+
+    // Adjacent rods in the same ordered phase, with aligned directors, share a domain
+    DisjointSets sets{ GP::NUM_RODS };
+    for (int i = 0; i < GP::NUM_RODS; ++i)
+    {
+        const Phase phase = domains.phase[i];
+        if (phase != Phase::DISORDERED)
+        {
+            // Tetratic directors are only defined up to pi/2
+            const double period = (phase == Phase::TETRATIC) ? 0.5 * std::numbers::pi : std::numbers::pi;
+            forEachAdjacent(i, [&](const int j)
+                {
+                    if (j < i && domains.phase[j] == phase && std::abs(std::remainder(dirs[i] - dirs[j], period)) < GP::ANALYSIS::DA_MAX)
+                    {
+                        sets.unite(i, j);
+                    }
+                });
+        }
+    }
+
+    // Consecutive labels, in order of first appearance
+    std::vector<int> label_of_root(GP::NUM_RODS, -1);
+    for (int i = 0; i < GP::NUM_RODS; ++i)
+    {
+        if (domains.phase[i] != Phase::DISORDERED)
+        {
+            int& label = label_of_root[sets.find(i)];
+            if (label < 0)
+            {
+                label = domains.numDomains++;
+            }
+            domains.label[i] = label;
+        }
+    }
+
+    for (int i = 0; i < GP::NUM_RODS; ++i)
+    {
+        forEachAdjacent(i, [&](const int j) { if (domains.label[j] != domains.label[i]) { domains.boundary[i] = true; } });
+    }
+
+    return domains;
+}
+
+[[nodiscard]] auto Analysis::findDefects() const -> std::vector<Defect>
+{
+    CellList boxes{ GP::ANALYSIS::DEFECT_BOX_W };
+    boxes.build(cell.getRods());
+    const int side = boxes.getSide();
+
+    // Director of each box, NaN where there are no rods or they are not ordered enough
+    std::vector<double> directors(side * side, std::numeric_limits<double>::quiet_NaN());
+    for (int b = 0; b < side * side; ++b)
+    {
+        int count{ 0 };
+        double cos2a{ 0.0 };
+        double sin2a{ 0.0 };
+        boxes.forEachInCell(b, [&](const int j)
+            {
+                cos2a += std::cos(2.0 * cell.getRod(j).a);
+                sin2a += std::sin(2.0 * cell.getRod(j).a);
+                ++count;
+            });
+        if (count > 0 && std::sqrt(cos2a * cos2a + sin2a * sin2a) > GP::ANALYSIS::DEFECT_Q_MIN * count)
+        {
+            directors[b] = 0.5 * std::atan2(sin2a, cos2a);
+        }
+    }
+
+    // Winding of the director counterclockwise around the corner shared by four boxes
+    std::vector<Defect> defects{};
+    for (int by = 0; by + 1 < side; ++by)
+    {
+        for (int bx = 0; bx + 1 < side; ++bx)
+        {
+            const std::array<double, 4> loop{ directors[bx + side * by], directors[bx + 1 + side * by],
+                                              directors[bx + 1 + side * (by + 1)], directors[bx + side * (by + 1)] };
+            if (std::ranges::any_of(loop, [](const double& d) { return std::isnan(d); }))
+            {
+                continue;
+            }
+
+            double winding{ 0.0 };
+            for (int k = 0; k < 4; ++k)
+            {
+                winding += std::remainder(loop[(k + 1) % 4] - loop[k], std::numbers::pi);
+            }
+            const double charge = 0.5 * std::round(winding / std::numbers::pi);
+            if (charge != 0.0)
+            {
+                defects.push_back({ (bx + 1) * boxes.getWidth() - GP::CELL::R_OUT, (by + 1) * boxes.getWidth() - GP::CELL::R_OUT, charge });
+            }
+        }
+    }
+
+    return defects;
+}
+
+auto Analysis::analizeDomains(const std::filesystem::path& file_in, const std::filesystem::path& file_out, const std::filesystem::path& defects_out) -> void
+{
+    if (!cell.fillFromFile(file_in))
+    {
+        std::cout << "ANALYSIS OF " << file_in << " SKIPPED!\n";
+        return;
+    }
+
+    const auto dirs = computeLocalDirectors();
+    const auto domains = findDomains(dirs, computeOrderParameters());
+
+    std::ofstream of(file_out);
+    if (of.is_open())
+    {
+        of << std::scientific << std::setprecision(15);
+        for (int i = 0; i < GP::NUM_RODS; ++i)
+        {
+            const Rod& rod = cell.getRod(i);
+
+            of << rod.x << "," << rod.y << "," << rod.a << "," << dirs[i] << ","
+               << static_cast<int>(domains.phase[i]) << "," << domains.label[i] << "," << domains.boundary[i] << '\n';
+        }
+        of.close();
+    }
+    else
+    {
+        std::cout << "FILE " << file_out << " COULD NOT BE OPENED!\n";
+    }
+
+    std::ofstream od(defects_out);
+    if (od.is_open())
+    {
+        od << std::scientific << std::setprecision(15);
+        std::ranges::for_each(findDefects(), [&](const Defect& d) { od << d.x << "," << d.y << "," << d.charge << '\n'; });
+        od.close();
+    }
+    else
+    {
+        std::cout << "FILE " << defects_out << " COULD NOT BE OPENED!\n";
+    }
+}
@@ -1,6 +1,9 @@
 #pragma once
 
 #include "annularCell.hpp"
+#include "trajectory.hpp"
+#include <vector>
+#include <forward_list>
 
 struct Params {
 	double q2;
@@ -8,10 +11,45 @@ struct Params {
 	double qS;
 };
 
+enum class Phase : int {
+	DISORDERED,
+	NEMATIC,
+	TETRATIC,
+	SMECTIC
+};
+
+/* Domains of rods in the same phase with aligned local directors.
+	- label: domain of each rod, -1 for disordered rods.
+	- boundary: whether any adjacent rod belongs to another domain.
+ */
+struct Domains {
+	std::vector<Phase> phase;
+	std::vector<int> label;
+	std::vector<bool> boundary;
+	int numDomains;
+};
+
+/* Topological defect of the director field, with charge +-1/2 (or +-1). */
+struct Defect {
+	double x;
+	double y;
+	double charge;
+};
+
 struct Analysis {
 	AnnularCell cell;
 
 	auto analize(const std::filesystem::path& file_in, const std::filesystem::path& file_out) -> void;
+	/* Analizes the next frame of trajectory. Returns false at its end. */
+	auto analize(TrajectoryReader& trajectory, const std::filesystem::path& file_out) -> bool;
+
+	/* Writes one line per rod: x,y,a,dir,q2,q4,qS */
+	auto save(const std::filesystem::path& file_out) const -> void;
+
+	/* Writes one line per rod: x,y,a,dir,phase,label,boundary
+	   and one line per defect to defects_out: x,y,charge
+	 */
+	auto analizeDomains(const std::filesystem::path& file_in, const std::filesystem::path& file_out, const std::filesystem::path& defects_out) -> void;
 
 	[[nodiscard]] auto getRegions() const->std::vector<std::forward_list<int>>;
 
@@ -22,4 +60,7 @@ struct Analysis {
 	[[nodiscard]] auto computeQS() const -> std::vector<double>;
 
 	[[nodiscard]] auto computeOrderParameters() const -> std::vector<Params>;
+
+	[[nodiscard]] auto findDomains(const std::vector<double>& dirs, const std::vector<Params>& params) const -> Domains;
+	[[nodiscard]] auto findDefects() const -> std::vector<Defect>;
 };
@@ -1,19 +1,18 @@
 #include "annularCell.hpp" // includes <cmath> and <numbers>
 #include <random>
+#include <chrono>
 #include <iostream>
 #include <iomanip>
 #include <fstream>
 #include <string>
-#include <sstream>
 #include <ranges>
 #include <algorithm>
+#include <limits>
+#include <utility>
+#include <vector>
 
 using std::numbers::pi;
 
-std::mt19937 gen(std::random_device{}());
-std::uniform_real_distribution<double> rand_dw(-GP::MC::dW, GP::MC::dW);
-std::uniform_real_distribution<double> rand_dl(-GP::MC::dL, GP::MC::dL);
-std::uniform_real_distribution<double> rand_da(-GP::MC::dA, GP::MC::dA);
 
 struct Vec2
 {
@@ -54,15 +53,29 @@ inline static auto coordinatesSFD(const Vec2& v, const Vec2& n) -> Vec2
 
 [[nodiscard]] auto AnnularCell::isOverlapingNeighbor(const Rod& rod) const -> bool
 {
-    const auto isOverlaping = [&](int n) { return (n!=rod.index) && rod.overlaps(m_bundle[n]); };
-    for (const auto& neighborBoxIndex : m_grid.m_neighborBoxesIndexes[m_grid.getBoxIndexAt(rod.x, rod.y)])
+    // Pruning the stencil only pays off on fine grids. Default configuration, ns per check (see getStencilStatistics):
+    // REACH 1: 400 full, 490 reduced. REACH 2: 520-660 full, 610-690 reduced. REACH 3: 590-790 full, 490-650 reduced.
+    if constexpr (GP::GRID::REACH <= 2)
     {
-        if (std::ranges::any_of(m_grid.m_boxes[neighborBoxIndex], isOverlaping))
-        {
-            return true;
-        }
+        return isOverlapingInStencil(rod);
+    }
+    else
+    {
+        return isOverlapingNearby(rod);
     }
-    return false;
+}
+
+[[nodiscard]] auto AnnularCell::isOverlapingInStencil(const Rod& rod) const -> bool
+{
+    const auto isOverlaping = [&](int n) { return (n!=rod.index) && rod.overlaps(m_bundle[n]); };
+    const int box = m_grid.getBoxIndexAt(rod.x, rod.y);
+    return std::ranges::any_of(m_grid.m_stencilOffsets, [&](const int offset) { return std::ranges::any_of(m_grid.m_boxes[box + offset], isOverlaping); });
+}
+
+[[nodiscard]] auto AnnularCell::isOverlapingNearby(const Rod& rod) const -> bool
+{
+    const auto isOverlaping = [&](int n) { return (n!=rod.index) && rod.overlaps(m_bundle[n]); };
+    return m_grid.anyBoxNear(rod.x, rod.y, [&](const int box) { return std::ranges::any_of(m_grid.m_boxes[box], isOverlaping); });
 }
 
 [[nodiscard]] inline auto AnnularCell::positionIsValid(const Rod& rod) const -> bool
@@ -72,13 +85,13 @@ inline static auto coordinatesSFD(const Vec2& v, const Vec2& n) -> Vec2
 
 auto AnnularCell::tryToMoveRod(Rod& rod, [[maybe_unused]] int& count) -> void
 {
-    const double dx = rand_dl(gen);
-    const double dy = rand_dw(gen);
+    const double dx = m_randDL(m_gen);
+    const double dy = m_randDW(m_gen);
 
     Rod newRod(rod);
     newRod.moveBy(dx * std::cos(newRod.a) - dy * std::sin(newRod.a),
                   dx * std::sin(newRod.a) + dy * std::cos(newRod.a),
-                  rand_da(gen));
+                  m_randDA(m_gen));
 
     if (positionIsValid(newRod))
     {
@@ -102,6 +115,17 @@ auto AnnularCell::tryToBringRodTowardsCenter(Rod& rod, const double& dr) -> void
     }
 }
 
+AnnularCell::AnnularCell()
+    : AnnularCell(std::random_device{}())
+{
+}
+
+AnnularCell::AnnularCell(const std::uint64_t seed)
+{
+    std::seed_seq sequence{ static_cast<std::uint32_t>(seed), static_cast<std::uint32_t>(seed >> 32) };
+    m_gen.seed(sequence);
+}
+
 [[nodiscard]] auto AnnularCell::getRod(const int idx) const -> const Rod&
 {
     return m_bundle[idx];
@@ -112,13 +136,56 @@ auto AnnularCell::tryToBringRodTowardsCenter(Rod& rod, const double& dr) -> void
     return m_bundle;
 }
 
+[[nodiscard]] auto AnnularCell::getSteps() const -> std::int64_t
+{
+    return m_steps;
+}
+
+auto AnnularCell::attachSnapshotBuffer(SnapshotBuffer& buffer, const int interval) -> void
+{
+    m_snapshotBuffers.emplace_back(&buffer, std::max(1, interval));
+}
+
+auto AnnularCell::detachSnapshotBuffers() -> void
+{
+    std::ranges::for_each(m_snapshotBuffers, [](const auto& sb) { sb.first->close(); });
+    m_snapshotBuffers.clear();
+}
+
 [[maybe_unused]] auto AnnularCell::MCStep() -> double
 {
     int successes{ 0 };
     std::ranges::for_each(m_bundle, [&](Rod& rod){ tryToMoveRod(rod, successes); });
+
+    ++m_steps;
+    for (const auto& [buffer, interval] : m_snapshotBuffers)
+    {
+        if (m_steps % interval == 0)
+        {
+            buffer->publish(m_bundle, m_steps);
+        }
+    }
+
     return (100.0 * successes) / GP::NUM_RODS;
 }
 
+[[maybe_unused]] auto AnnularCell::MCSteps(const int n, const StepCallback& callback) -> double
+{
+    double mean_acceptance{ 0.0 };
+    int s = 0;
+    while (s < n)
+    {
+        const double acceptance = MCStep();
+        mean_acceptance += acceptance;
+        ++s;
+        if (callback && !callback(s, acceptance))
+        {
+            break;
+        }
+    }
+    return (s > 0) ? mean_acceptance / s : 0.0;
+}
+
 [[maybe_unused]] auto AnnularCell::thermalize() -> double
 {
     double mean_acceptance{ 0.0 };
@@ -129,38 +196,384 @@ auto AnnularCell::tryToBringRodTowardsCenter(Rod& rod, const double& dr) -> void
     return mean_acceptance / GP::MC::THERMAL_STEPS;
 }
 
+struct ThermalSample
+{
+    double order;
+    double radius;
+    double acceptance;
+};
+
+static auto sampleObservables(const std::array<Rod, GP::NUM_RODS>& rods, const double& acceptance) -> ThermalSample
+{
+    ThermalSample sample{ 0.0, 0.0, acceptance };
+    for (const Rod& rod : rods)
+    {
+        sample.order += std::cos(2.0 * (rod.a - std::atan2(rod.y, rod.x)));
+        sample.radius += std::sqrt(rod.x * rod.x + rod.y * rod.y);
+    }
+    sample.order /= GP::NUM_RODS;
+    sample.radius /= GP::NUM_RODS;
+    return sample;
+}
+
+// Integrated autocorrelation time, in samples, of a zero mean series, summed over Sokal's automatic window
+static auto autocorrelationTime(const std::vector<double>& series) -> double
+{
+    const int n = static_cast<int>(series.size());
+    const auto autocovariance = [&](const int t) {
+        double c{ 0.0 };
+        for (int i = 0; i + t < n; ++i)
+        {
+            c += series[i] * series[i + t];
+        }
+        return c / n;
+    };
+
+    const double c0 = autocovariance(0);
+    double tau{ 0.5 };
+    if (c0 <= 0.0)
+    {
+        return tau;
+    }
+    for (int t = 1; t < n / 2 && t < GP::MC::THERMAL_SOKAL_C * tau; ++t)
+    {
+        tau += autocovariance(t) / c0;
+    }
+    return std::max(tau, 0.5);
+}
+
+struct DriftTest
+{
+    double z;   // Slope, in standard errors
+    double tau; // Integrated autocorrelation time of the residuals, in samples
+};
+
+// Slope of the second half of the samples, against its error for autocorrelated residuals
+static auto drift(const std::vector<ThermalSample>& samples, double ThermalSample::* observable) -> DriftTest
+{
+    // The first half is discarded as transient
+    const int first = static_cast<int>(samples.size()) / 2;
+    const int n = static_cast<int>(samples.size()) - first;
+
+    // Least squares fit of samples[first + i] = intercept + slope * i
+    const double mean_i = 0.5 * (n - 1);
+    double mean{ 0.0 };
+    for (int i = 0; i < n; ++i)
+    {
+        mean += samples[first + i].*observable;
+    }
+    mean /= n;
+
+    double sxx{ 0.0 };
+    double sxy{ 0.0 };
+    for (int i = 0; i < n; ++i)
+    {
+        sxx += (i - mean_i) * (i - mean_i);
+        sxy += (i - mean_i) * (samples[first + i].*observable - mean);
+    }
+    const double slope = sxy / sxx;
+
+    std::vector<double> residuals(n);
+    double ssr{ 0.0 };
+    for (int i = 0; i < n; ++i)
+    {
+        residuals[i] = samples[first + i].*observable - mean - slope * (i - mean_i);
+        ssr += residuals[i] * residuals[i];
+    }
+
+    // Correlated residuals shrink the number of independent samples by 2 tau
+    const double tau = autocorrelationTime(residuals);
+    const double err = std::sqrt(2.0 * tau * ssr / (n - 2) / sxx);
+
+    if (err > 0.0)
+    {
+        return { std::abs(slope) / err, tau };
+    }
+    return { (slope != 0.0) ? std::numeric_limits<double>::infinity() : 0.0, tau };
+}
+
+[[maybe_unused]] auto AnnularCell::equilibrate() -> double
+{
+    std::ofstream log(GP::IO::THERMAL_LOG);
+    if (!log.is_open())
+    {
+        std::cout << "FILE " << GP::IO::THERMAL_LOG << " COULD NOT BE OPENED! Convergence trace will not be saved.\n";
+    }
+    log << "step,order,radius,acceptance,z_order,z_radius,z_acceptance,tau_order,tau_radius,tau_acceptance,streak\n";
+    log << std::scientific << std::setprecision(6);
+
+    std::vector<ThermalSample> samples{};
+    samples.reserve(GP::MC::THERMAL_STEPS / GP::MC::THERMAL_SAMPLE_INTERVAL + 1);
+
+    double mean_acceptance{ 0.0 };
+    int steps{ 0 };
+    int streak{ 0 };
+    while (steps < GP::MC::THERMAL_STEPS)
+    {
+        double acceptance{ 0.0 };
+        for (int s = 0; s < GP::MC::THERMAL_SAMPLE_INTERVAL && steps < GP::MC::THERMAL_STEPS; ++s, ++steps)
+        {
+            acceptance += MCStep();
+        }
+        mean_acceptance += acceptance;
+        samples.push_back(sampleObservables(m_bundle, acceptance / GP::MC::THERMAL_SAMPLE_INTERVAL));
+
+        // Check once per window, so that every check adds a full window of new samples
+        if (samples.size() % GP::MC::THERMAL_WINDOW == 0 && samples.size() >= 2 * GP::MC::THERMAL_WINDOW)
+        {
+            const std::array<DriftTest, 3> tests{ drift(samples, &ThermalSample::order),
+                                                  drift(samples, &ThermalSample::radius),
+                                                  drift(samples, &ThermalSample::acceptance) };
+            // Each observable is tested at THERMAL_ALPHA / 3, so that the check as a whole is at THERMAL_ALPHA
+            const double n = static_cast<double>(samples.size() - samples.size() / 2);
+            const bool stationary = std::ranges::all_of(tests, [&](const DriftTest& test) {
+                const double p_value = std::erfc(test.z / std::numbers::sqrt2);
+                return p_value > GP::MC::THERMAL_ALPHA / tests.size() && n / (2.0 * test.tau) >= GP::MC::THERMAL_MIN_EFFECTIVE;
+            });
+            streak = stationary ? streak + 1 : 0;
+
+            const ThermalSample& sample = samples.back();
+            log << steps << "," << sample.order << "," << sample.radius << "," << sample.acceptance << ","
+                << tests[0].z << "," << tests[1].z << "," << tests[2].z << ","
+                << tests[0].tau << "," << tests[1].tau << "," << tests[2].tau << "," << streak << std::endl;
+
+            if (streak >= GP::MC::THERMAL_PATIENCE && steps >= GP::MC::THERMAL_MIN_STEPS)
+            {
+                break;
+            }
+        }
+    }
+
+    if (streak >= GP::MC::THERMAL_PATIENCE)
+    {
+        std::cout << "Equilibrated after " << steps << " steps.\n";
+    }
+    else
+    {
+        std::cout << "WARNING: NOT EQUILIBRATED AFTER " << steps << " STEPS!\n";
+    }
+    return mean_acceptance / steps;
+}
+
 [[maybe_unused]] auto AnnularCell::MCSimulation() -> double
 {
     double mean_acceptance{ 0.0 };
     for (int s = 0; s < GP::MC::MC_STEPS; s++)
     {
         mean_acceptance += MCStep();
+        if ((s + 1) % GP::PRESSURE::SAMPLE_INTERVAL == 0)
+        {
+            samplePressure();
+        }
     }
     return mean_acceptance / GP::MC::MC_STEPS;
 }
 
-[[maybe_unused]] auto AnnularCell::fillFromFile(const std::filesystem::path& filename) -> bool
+auto AnnularCell::samplePressure() -> void
 {
-    std::ifstream infile(filename);
-    if (infile.is_open())
+    for (const Rod& rod : m_bundle)
     {
-        char c; // Only for commas
-        int i = 0;
-        for (std::string line; std::getline(infile, line) && i < GP::NUM_RODS; ++i)
+        const double sqDist = rod.x * rod.x + rod.y * rod.y;
+
+        // Outer wall: the farthest point of a rod is one of its corners
+        if (sqDist > GP::PRESSURE::OUTER_CANDIDATE_SQ
+            && std::ranges::max(rod.getCornersRadiiSq()) > GP::PRESSURE::OUTER_SQ)
         {
-            std::istringstream ss(line);
-            ss >> m_bundle[i].x >> c >> m_bundle[i].y >> c >> m_bundle[i].a;
-            m_bundle[i].index = i;
-            m_grid.addIndexAt(i, m_bundle[i].x, m_bundle[i].y);
+            ++m_pressure.outerWall;
         }
-        infile.close();
-        return true;
+
+        // Inner wall: distance from the center of the cell to the rod rectangle
+        if (sqDist < GP::PRESSURE::INNER_CANDIDATE_SQ)
+        {
+            const Vec2 d = coordinatesSFD({ rod.x, rod.y }, { std::cos(rod.a), std::sin(rod.a) });
+            m_pressure.innerWall += ((d.x * d.x + d.y * d.y) < GP::PRESSURE::INNER_SQ);
+        }
+
+        // Bulk: pairs that overlap once every position is scaled by 1 - EPSILON, each one counted once
+        const Rod compressed{ GP::PRESSURE::SCALE * rod.x, GP::PRESSURE::SCALE * rod.y, rod.a, rod.index };
+        m_grid.anyBoxWithin(rod.x, rod.y, GP::PRESSURE::CONTACT_D, [&](const int box)
+            {
+                for (const int n : m_grid.m_boxes[box])
+                {
+                    const Rod& other = m_bundle[n];
+                    const double dx = other.x - rod.x;
+                    const double dy = other.y - rod.y;
+                    if (n > rod.index && dx * dx + dy * dy <= GP::PRESSURE::CONTACT_D_SQ
+                        && compressed.overlaps({ GP::PRESSURE::SCALE * other.x, GP::PRESSURE::SCALE * other.y, other.a, other.index }))
+                    {
+                        ++m_pressure.bulkPairs;
+                    }
+                }
+                return false;
+            });
     }
-    else
+    ++m_pressure.samples;
+}
+
+auto AnnularCell::resetPressure() -> void
+{
+    m_pressure = PressureCounts{};
+}
+
+[[nodiscard]] auto AnnularCell::getPressureCounts() const -> const PressureCounts&
+{
+    return m_pressure;
+}
+
+[[nodiscard]] auto AnnularCell::getPressure() const -> Pressure
+{
+    if (m_pressure.samples == 0)
     {
-        std::cout << "FILE " << filename <<" COULD NOT BE OPENED!\n";
-        return false;
+        return {};
     }
+    // Compressing by dA creates overlaps with probability beta * P_ex * dA, for small dA
+    const double samples = static_cast<double>(m_pressure.samples);
+    return { GP::PRESSURE::DENSITY + m_pressure.bulkPairs / (samples * GP::PRESSURE::DA_BULK),
+             m_pressure.outerWall / (samples * GP::PRESSURE::DA_OUTER),
+             m_pressure.innerWall / (samples * GP::PRESSURE::DA_INNER) };
+}
+
+auto AnnularCell::rebuildGrid() -> void
+{
+    m_grid = Grid{};
+    std::ranges::for_each(m_bundle, [&](const Rod& rod) { m_grid.addIndexAt(rod.index, rod.x, rod.y); });
+}
+
+auto AnnularCell::validateIntoGrid(LoadReport& report) -> void
+{
+    m_grid = Grid{};
+    auto parse_error = report.parseErrors.cbegin(); // In line order
+    for (const Rod& rod : m_bundle | std::views::take(report.numRods))
+    {   // Malformed lines are already reported, and their rods hold stale coordinates
+        if (parse_error != report.parseErrors.cend() && parse_error->line == rod.index + 1)
+        {
+            ++parse_error;
+            continue;
+        }
+        // Rods outside the walls could lie beyond the grid, so only valid ones are added
+        if (!m_grid.isWithinFrame(rod.x, rod.y) || !rodIsWithinWalls(rod))
+        {
+            report.outsideWalls.push_back(rod.index);
+            continue;
+        }
+        m_grid.anyBoxNear(rod.x, rod.y, [&](const int box)
+            {
+                for (const int n : m_grid.m_boxes[box])
+                {   // Only rods already added, so each pair is reported once
+                    if (rod.overlaps(m_bundle[n]))
+                    {
+                        report.overlaps.emplace_back(n, rod.index);
+                    }
+                }
+                return false;
+            });
+        m_grid.addIndexAt(rod.index, rod.x, rod.y);
+    }
+    std::ranges::sort(report.overlaps);
+}
+
+[[nodiscard]] auto AnnularCell::getStencilStatistics() const -> StencilStatistics
+{
+    StencilStatistics stats{};
+    for (const Rod& rod : m_bundle)
+    {
+        const int rod_box = m_grid.getBoxIndexAt(rod.x, rod.y);
+        for (const int offset : m_grid.m_stencilOffsets)
+        {
+            ++stats.fullBoxes;
+            for (const int n : m_grid.m_boxes[rod_box + offset])
+            {
+                stats.fullCandidates += (n != rod.index);
+                if (n != rod.index)
+                {
+                    const double dx = m_bundle[n].x - rod.x;
+                    const double dy = m_bundle[n].y - rod.y;
+                    stats.withinD += (dx * dx + dy * dy <= GP::ROD::D_SQ);
+                }
+            }
+        }
+        m_grid.anyBoxNear(rod.x, rod.y, [&](const int box)
+            {
+                ++stats.reducedBoxes;
+                stats.reducedCandidates += std::ranges::count_if(m_grid.m_boxes[box], [&](const int n) { return n != rod.index; });
+                return false;
+            });
+    }
+    // Same trial moves for both stencils, drawn apart from the simulation's generator
+    constexpr int REPETITIONS{ 20 };
+    std::mt19937 gen{ 0 };
+    auto rand_dl = m_randDL;
+    auto rand_dw = m_randDW;
+    auto rand_da = m_randDA;
+    std::vector<Rod> trials(m_bundle.begin(), m_bundle.end());
+    for (Rod& rod : trials)
+    {
+        const double dx = rand_dl(gen);
+        const double dy = rand_dw(gen);
+        rod.moveBy(dx * std::cos(rod.a) - dy * std::sin(rod.a), dx * std::sin(rod.a) + dy * std::cos(rod.a), rand_da(gen));
+    }
+    const auto timeChecks = [&](auto&& check) {
+        int overlaps{ 0 };
+        const auto tic = std::chrono::steady_clock::now();
+        for (int r = 0; r < REPETITIONS; ++r)
+        {
+            std::ranges::for_each(trials, [&](const Rod& rod) { overlaps += check(rod); });
+        }
+        const auto toc = std::chrono::steady_clock::now();
+        return std::pair{ std::chrono::duration<double, std::nano>(toc - tic).count() / (REPETITIONS * trials.size()), overlaps };
+    };
+    const auto [full_ns, full_overlaps] = timeChecks([&](const Rod& rod) { return isOverlapingInStencil(rod); });
+    const auto [reduced_ns, reduced_overlaps] = timeChecks([&](const Rod& rod) { return isOverlapingNearby(rod); });
+    stats.fullNs = full_ns;
+    stats.reducedNs = reduced_ns;
+    if (full_overlaps != reduced_overlaps)
+    {
+        std::cout << "WARNING: THE STENCILS DISAGREE ON " << std::abs(full_overlaps - reduced_overlaps) << " TRIAL MOVES!\n";
+    }
+
+    const double inv_n = 1.0 / GP::NUM_RODS;
+    stats.fullBoxes *= inv_n;
+    stats.reducedBoxes *= inv_n;
+    stats.fullCandidates *= inv_n;
+    stats.reducedCandidates *= inv_n;
+    stats.withinD *= inv_n;
+    return stats;
+}
+
+[[maybe_unused]] auto AnnularCell::fillFromFile(const std::filesystem::path& filename) -> bool
+{
+    LoadReport report{};
+    const bool is_valid = fillFromFile(filename, report);
+    if (!is_valid)
+    {
+        report.print(filename);
+    }
+    return is_valid;
+}
+
+[[maybe_unused]] auto AnnularCell::fillFromFile(const std::filesystem::path& filename, LoadReport& report) -> bool
+{
+    MappedFile file{};
+    report = LoadReport{};
+    report.opened = file.open(filename);
+    if (report.opened)
+    {
+        m_bundle = std::array<Rod, GP::NUM_RODS>{};
+        for (int i = 0; i < GP::NUM_RODS; ++i)
+        {
+            m_bundle[i].index = i;
+        }
+        report.numRods = parseRods(file.view(), m_bundle, report);
+
+        validateIntoGrid(report);
+    }
+    return report.isValid();
+}
+
+auto AnnularCell::fillFromRods(const std::array<Rod, GP::NUM_RODS>& rods) -> void
+{
+    m_bundle = rods;
+    rebuildGrid();
 }
 
 [[maybe_unused]] auto AnnularCell::fill() -> bool
@@ -243,8 +656,8 @@ auto AnnularCell::tryToBringRodTowardsCenter(Rod& rod, const double& dr) -> void
             m_bundle[current_index].index = current_index;
             do 
             {
-                const double x = distR(gen);
-                const double y = distR(gen);
+                const double x = distR(m_gen);
+                const double y = distR(m_gen);
                 m_bundle[current_index].moveBy(x, y, std::atan2(y, x));
             } while (!positionIsValid(m_bundle[current_index]));
 
@@ -3,22 +3,110 @@
 #include "GlobalParameters.hpp" // includes <cmath>, <numbers> and <filesystem>
 #include "rod.hpp"
 #include "grid.hpp"
+#include "csvLoader.hpp"
+#include "snapshot.hpp"
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <utility>
+#include <vector>
+
+/* Called after each step of AnnularCell::MCSteps with the number of steps done and
+   the acceptance of the last step. Returning false stops the run.
+ */
+using StepCallback = std::function<bool(const int step, const double acceptance)>;
+
+/* Mean, per rod, of the boxes and rods visited by the overlap check, and its cost on trial moves.
+	- full: the whole compile-time stencil of GP::GRID::STENCIL_SIZE boxes.
+	- reduced: the position-aware stencil, see Grid::anyBoxNear.
+	- withinD: rods closer than a rod diagonal, the true candidate set.
+	- ns: mean time of one overlap check of a trial move (as in MCStep) with each stencil.
+ */
+struct StencilStatistics {
+	double fullBoxes{ 0.0 };
+	double reducedBoxes{ 0.0 };
+	double fullCandidates{ 0.0 };
+	double reducedCandidates{ 0.0 };
+	double withinD{ 0.0 };
+	double fullNs{ 0.0 };
+	double reducedNs{ 0.0 };
+};
+
+/* Virtual compressions creating overlaps, accumulated over samples (see GP::PRESSURE).
+	- bulkPairs: rod pairs overlapping once their separation shrinks by GP::PRESSURE::EPSILON.
+	- outerWall, innerWall: rods crossing the wall once it moves GP::PRESSURE::DR_WALL towards them.
+ */
+struct PressureCounts {
+	std::int64_t samples{ 0 };
+	std::int64_t bulkPairs{ 0 };
+	std::int64_t outerWall{ 0 };
+	std::int64_t innerWall{ 0 };
+};
+
+/* Reduced pressures, beta * P, in units of 1/length^2.
+	- bulk: ideal plus pair (virial) term, from the rod-rod contacts only.
+	- outerWall, innerWall: force per unit length on each wall, from the density of rods in contact with it.
+ */
+struct Pressure {
+	double bulk{ 0.0 };
+	double outerWall{ 0.0 };
+	double innerWall{ 0.0 };
+};
 
 class AnnularCell {
 public:
+	/* Each cell owns its random number generator, so that cells can run on different threads.
+		- The default constructor seeds it from std::random_device.
+		- Cells built with the same seed and configuration produce the same run.
+	 */
+	AnnularCell();
+	explicit AnnularCell(const std::uint64_t seed);
+
 	[[nodiscard]] auto getRod(const int idx) const -> const Rod&;
 	[[nodiscard]] auto getRods() const ->  const std::array<Rod, GP::NUM_RODS>&;
 
+	[[nodiscard]] auto getSteps() const -> std::int64_t;
+	[[nodiscard]] auto getStencilStatistics() const -> StencilStatistics;
+
+	/* Pressure estimator from virtual compressions, which only tests near-contact candidates.
+		- samplePressure() adds the overlaps of the current configuration to the counts.
+		- MCSimulation() samples every GP::PRESSURE::SAMPLE_INTERVAL steps, across calls until resetPressure().
+	 */
+	auto samplePressure() -> void;
+	auto resetPressure() -> void;
+	[[nodiscard]] auto getPressureCounts() const -> const PressureCounts&;
+	[[nodiscard]] auto getPressure() const -> Pressure;
+
+	/* Publishes the rods to buffer every interval MC steps, so that other threads can analyze them
+	   while the simulation goes on. Publishing never blocks the simulation.
+	 */
+	auto attachSnapshotBuffer(SnapshotBuffer& buffer, const int interval) -> void;
+	auto detachSnapshotBuffers() -> void; // Also closes them
+
 	[[maybe_unused]] auto MCStep() -> double;
+	[[maybe_unused]] auto MCSteps(const int n, const StepCallback& callback = {}) -> double;
 	[[maybe_unused]] auto thermalize() -> double;
+
+	/* Thermalizes until the system is stationary (see GP::MC::THERMAL_*).
+		- Tracks the order relative to the walls <cos 2(a - theta)>, the mean radial position and the acceptance.
+		- Writes the convergence trace to GP::IO::THERMAL_LOG, one line per check.
+		- Returns the mean acceptance.
+	 */
+	[[maybe_unused]] auto equilibrate() -> double;
 	[[maybe_unused]] auto MCSimulation() -> double;
 
 	/* Fills the Cell with coordinates saved in file.
 		- Each line in filename is exactly of the form: x,y,a
 		- Filled only up to GP::NUM_RODS number of rods.
-		* FIXME: Does not check for coordinates validity.
+		- Returns false, and prints what went wrong, unless every rod is read,
+		  lies within the walls and does not overlap any other rod.
 	 */
 	[[maybe_unused]] auto fillFromFile(const std::filesystem::path& filename) -> bool;
+	[[maybe_unused]] auto fillFromFile(const std::filesystem::path& filename, LoadReport& report) -> bool;
+	/* Fills the Cell with the given rods, without any validity check.
+		- Meant for trusted sources, such as trajectories written by this program.
+	 */
+	auto fillFromRods(const std::array<Rod, GP::NUM_RODS>& rods) -> void;
 	[[maybe_unused]] auto fill() -> bool;
 	[[maybe_unused]] auto save(const std::filesystem::path& filename, const int n) const -> bool;
 
@@ -26,6 +114,11 @@ private:
 	[[nodiscard]] inline auto rodIsWithinWalls(const Rod& rod) const -> bool;
 
 	[[nodiscard]] auto isOverlapingNeighbor(const Rod& rod) const -> bool;
+	[[nodiscard]] auto isOverlapingInStencil(const Rod& rod) const -> bool;
+	[[nodiscard]] auto isOverlapingNearby(const Rod& rod) const -> bool;
+
+	auto rebuildGrid() -> void;
+	auto validateIntoGrid(LoadReport& report) -> void; // Adds to the grid only the rods within the walls
 	
 	[[nodiscard]] inline auto positionIsValid(const Rod& rod) const -> bool;
 
@@ -35,4 +128,12 @@ private:
 private:
 	std::array<Rod, GP::NUM_RODS> m_bundle{};
 	Grid m_grid{};
+	std::int64_t m_steps{ 0 };
+	PressureCounts m_pressure{};
+	std::vector<std::pair<SnapshotBuffer*, int>> m_snapshotBuffers{};
+
+	std::mt19937 m_gen{};
+	std::uniform_real_distribution<double> m_randDW{ -GP::MC::dW, GP::MC::dW };
+	std::uniform_real_distribution<double> m_randDL{ -GP::MC::dL, GP::MC::dL };
+	std::uniform_real_distribution<double> m_randDA{ -GP::MC::dA, GP::MC::dA };
 };
\ No newline at end of file
@@ -0,0 +1,153 @@
+#include "annularCell_c.h"
+#include "annularCell.hpp"
+#include <cstddef>
+
+static_assert(sizeof(ac_rod) == sizeof(Rod));
+static_assert(offsetof(ac_rod, x) == offsetof(Rod, x));
+static_assert(offsetof(ac_rod, y) == offsetof(Rod, y));
+static_assert(offsetof(ac_rod, a) == offsetof(Rod, a));
+static_assert(offsetof(ac_rod, index) == offsetof(Rod, index));
+
+struct ac_cell
+{
+    AnnularCell cell;
+};
+
+const char* ac_version(void)
+{
+    return ANNULARCELL_VERSION;
+}
+
+int ac_num_rods(void)
+{
+    return GP::NUM_RODS;
+}
+
+ac_cell* ac_create(void)
+{
+    try
+    {   // std::random_device may throw
+        return new ac_cell{};
+    }
+    catch (...)
+    {
+        return nullptr;
+    }
+}
+
+ac_cell* ac_create_seeded(uint64_t seed)
+{
+    try
+    {
+        return new ac_cell{ AnnularCell{ seed } };
+    }
+    catch (...)
+    {
+        return nullptr;
+    }
+}
+
+void ac_destroy(ac_cell* cell)
+{
+    delete cell;
+}
+
+int ac_fill(ac_cell* cell)
+{
+    try
+    {
+        return cell->cell.fill() ? 1 : 0;
+    }
+    catch (...)
+    {
+        return 0;
+    }
+}
+
+int ac_fill_from_file(ac_cell* cell, const char* filename)
+{
+    try
+    {
+        return cell->cell.fillFromFile(filename) ? 1 : 0;
+    }
+    catch (...)
+    {
+        return 0;
+    }
+}
+
+int ac_save(const ac_cell* cell, const char* filename)
+{
+    try
+    {
+        return cell->cell.save(filename, GP::NUM_RODS) ? 1 : 0;
+    }
+    catch (...)
+    {
+        return 0;
+    }
+}
+
+double ac_mc_step(ac_cell* cell)
+{
+    try
+    {
+        return cell->cell.MCStep();
+    }
+    catch (...)
+    {
+        return -1.0;
+    }
+}
+
+double ac_mc_steps(ac_cell* cell, int n, ac_step_callback callback, void* user_data)
+{
+    try
+    {
+        if (callback == nullptr)
+        {
+            return cell->cell.MCSteps(n);
+        }
+        return cell->cell.MCSteps(n, [&](const int step, const double acceptance) { return callback(step, acceptance, user_data) != 0; });
+    }
+    catch (...)
+    {
+        return -1.0;
+    }
+}
+
+double ac_equilibrate(ac_cell* cell)
+{
+    try
+    {
+        return cell->cell.equilibrate();
+    }
+    catch (...)
+    {
+        return 0.0;
+    }
+}
+
+void ac_sample_pressure(ac_cell* cell)
+{
+    cell->cell.samplePressure();
+}
+
+void ac_reset_pressure(ac_cell* cell)
+{
+    cell->cell.resetPressure();
+}
+
+int ac_pressure(const ac_cell* cell, double* bulk, double* outer_wall, double* inner_wall)
+{
+    const Pressure pressure = cell->cell.getPressure();
+    *bulk = pressure.bulk;
+    *outer_wall = pressure.outerWall;
+    *inner_wall = pressure.innerWall;
+    return (cell->cell.getPressureCounts().samples > 0) ? 1 : 0;
+}
+
+const ac_rod* ac_rods(const ac_cell* cell)
+{
+    return reinterpret_cast<const ac_rod*>(cell->cell.getRods().data());
+}
@@ -0,0 +1,63 @@
+#ifndef ANNULARCELL_C_H
+#define ANNULARCELL_C_H
+
+/**
+ * C interface of the AnnularCellCore library.
+ *  - Functions returning int return 1 on success and 0 on failure.
+ *  - Pointers returned by ac_rods() stay valid, and are updated in place,
+ *    until the cell is destroyed.
+ */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct ac_cell ac_cell;
+
+/* Same layout as Rod. */
+typedef struct ac_rod
+{
+    double x;
+    double y;
+    double a; /* angle in interval [-HALF_PI, HALF_PI] */
+    int index;
+} ac_rod;
+
+/* Called after each step with the number of steps done and the acceptance (%) of the last one.
+   Returning 0 stops the run. */
+typedef int (*ac_step_callback)(int step, double acceptance, void* user_data);
+
+const char* ac_version(void);
+int ac_num_rods(void);
+
+/* ac_create seeds the random number generator of the cell from the system, ac_create_seeded from seed,
+   so that runs are reproducible. Each cell may be stepped on its own thread.
+   Both return NULL on failure. */
+ac_cell* ac_create(void);
+ac_cell* ac_create_seeded(uint64_t seed);
+void ac_destroy(ac_cell* cell);
+
+int ac_fill(ac_cell* cell);
+int ac_fill_from_file(ac_cell* cell, const char* filename);
+int ac_save(const ac_cell* cell, const char* filename);
+
+/* Return the mean acceptance (%), or -1 on failure (ac_equilibrate returns 0) */
+double ac_mc_step(ac_cell* cell);
+double ac_mc_steps(ac_cell* cell, int n, ac_step_callback callback, void* user_data);
+double ac_equilibrate(ac_cell* cell);
+
+/* Pressure estimator, see AnnularCell::samplePressure. ac_pressure returns 0 if nothing was sampled. */
+void ac_sample_pressure(ac_cell* cell);
+void ac_reset_pressure(ac_cell* cell);
+int ac_pressure(const ac_cell* cell, double* bulk, double* outer_wall, double* inner_wall);
+
+/* Read-only view of the ac_num_rods() rods of the cell, without copies. */
+const ac_rod* ac_rods(const ac_cell* cell);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ANNULARCELL_C_H */
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "GlobalParameters.hpp" // includes <cmath>, <numbers> and <filesystem>
+#include "rod.hpp"
+#include <algorithm>
+#include <vector>
+
+/* Square cells of width >= minWidth covering [-R_OUT, R_OUT]^2, rebuilt for every frame.
+	- Rods closer than minWidth are always in the same or in adjacent cells.
+	- Unlike Grid, the cell width is not tied to the rod size, so it suits any analysis cutoff.
+ */
+class CellList {
+public:
+	explicit CellList(const double& minWidth)
+		: m_side{ std::max(1, static_cast<int>(2.0 * GP::CELL::R_OUT / minWidth)) },
+		  m_invW{ m_side / (2.0 * GP::CELL::R_OUT) },
+		  m_cellStart(m_side * m_side + 1),
+		  m_cellOf(GP::NUM_RODS),
+		  m_sorted(GP::NUM_RODS)
+	{}
+
+	auto build(const std::array<Rod, GP::NUM_RODS>& rods) -> void
+	{
+		// Counting sort of the rods by cell
+		std::ranges::fill(m_cellStart, 0);
+		for (int i = 0; i < GP::NUM_RODS; ++i)
+		{
+			m_cellOf[i] = getCellAt(rods[i].x, rods[i].y);
+			++m_cellStart[m_cellOf[i] + 1];
+		}
+		for (std::size_t c = 1; c < m_cellStart.size(); ++c)
+		{
+			m_cellStart[c] += m_cellStart[c - 1];
+		}
+		std::vector<int> next(m_cellStart.begin(), m_cellStart.end() - 1);
+		for (int i = 0; i < GP::NUM_RODS; ++i)
+		{
+			m_sorted[next[m_cellOf[i]]++] = i;
+		}
+	}
+
+	[[nodiscard]] auto getSide() const -> int { return m_side; }
+	[[nodiscard]] auto getWidth() const -> double { return 1.0 / m_invW; }
+	[[nodiscard]] auto getCellOf(const int idx) const -> int { return m_cellOf[idx]; }
+
+	[[nodiscard]] auto getCellAt(const double& x, const double& y) const -> int
+	{
+		return coordinate(x) + m_side * coordinate(y);
+	}
+
+	// Calls f(j) for every rod j in the given cell
+	template <typename F>
+	auto forEachInCell(const int cell, F&& f) const -> void
+	{
+		for (int k = m_cellStart[cell]; k < m_cellStart[cell + 1]; ++k)
+		{
+			f(m_sorted[k]);
+		}
+	}
+
+	// Calls f(j) for every rod j in the cell of rod idx and its 8 neighbors (idx included)
+	template <typename F>
+	auto forEachCandidate(const int idx, F&& f) const -> void
+	{
+		const int cx = m_cellOf[idx] % m_side;
+		const int cy = m_cellOf[idx] / m_side;
+		for (int ny = std::max(0, cy - 1); ny <= std::min(m_side - 1, cy + 1); ++ny)
+		{
+			for (int nx = std::max(0, cx - 1); nx <= std::min(m_side - 1, cx + 1); ++nx)
+			{
+				forEachInCell(nx + m_side * ny, f);
+			}
+		}
+	}
+
+private:
+	[[nodiscard]] auto coordinate(const double& x) const -> int
+	{
+		return std::clamp(static_cast<int>((x + GP::CELL::R_OUT) * m_invW), 0, m_side - 1);
+	}
+
+private:
+	int m_side;
+	double m_invW;
+	std::vector<int> m_cellStart;
+	std::vector<int> m_cellOf;
+	std::vector<int> m_sorted;
+};
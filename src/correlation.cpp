@@ -0,0 +1,198 @@
+#include "correlation.hpp"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <thread>
+
+using std::numbers::pi;
+
+auto CorrelationBins::merge(const CorrelationBins& other) -> void
+{
+    for (int b = 0; b < GP::ANALYSIS::CORR_BINS; ++b)
+    {
+        count[b] += other.count[b];
+        c2[b] += other.c2[b];
+        c4[b] += other.c4[b];
+        cS[b] += other.cS[b];
+    }
+}
+
+auto CorrelationBins::clear() -> void
+{
+    std::ranges::fill(count, 0.0);
+    std::ranges::fill(c2, 0.0);
+    std::ranges::fill(c4, 0.0);
+    std::ranges::fill(cS, 0.0);
+}
+
+Correlations::Correlations()
+    : m_numThreads{ static_cast<int>(std::clamp(std::thread::hardware_concurrency(), 1u, GP::NUM_RODS)) },
+      m_threadBins(m_numThreads),
+      m_start{ m_numThreads },
+      m_done{ m_numThreads }
+{
+    // The calling thread takes range 0
+    m_workers.reserve(m_numThreads - 1);
+    for (int t = 1; t < m_numThreads; ++t)
+    {
+        m_workers.emplace_back([this, t]() { work(t); });
+    }
+}
+
+Correlations::~Correlations()
+{
+    m_stopping = true;
+    m_start.arrive_and_wait();
+}
+
+auto Correlations::work(const int t) -> void
+{
+    while (true)
+    {
+        m_start.arrive_and_wait();
+        if (m_stopping)
+        {
+            return;
+        }
+        accumulateThread(t);
+        m_done.arrive_and_wait();
+    }
+}
+
+auto Correlations::accumulateThread(const int t) -> void
+{
+    const int begin = (t * static_cast<int>(GP::NUM_RODS)) / m_numThreads;
+    const int end = ((t + 1) * static_cast<int>(GP::NUM_RODS)) / m_numThreads;
+    m_threadBins[t].clear();
+    accumulateRange(*m_frame, begin, end, m_threadBins[t]);
+}
+
+auto Correlations::accumulateRange(const std::array<Rod, GP::NUM_RODS>& rods, const int begin, const int end, CorrelationBins& bins) const -> void
+{
+    constexpr double K = 2.0 * pi * GP::ANALYSIS::Q;
+
+    for (int i = begin; i < end; ++i)
+    {
+        const Rod& ref = rods[i];
+        const double cos_ref = std::cos(ref.a);
+        const double sin_ref = std::sin(ref.a);
+
+        m_cells.forEachCandidate(i, [&](const int j)
+            {
+                if (j <= i)
+                {   // Each pair is counted once
+                    return;
+                }
+
+                const Rod& rod = rods[j];
+                const double dx = rod.x - ref.x;
+                const double dy = rod.y - ref.y;
+                const double sqDist = dx * dx + dy * dy;
+                if (sqDist >= GP::ANALYSIS::R_CORR_SQ)
+                {
+                    return;
+                }
+
+                const int b = std::min(static_cast<int>(std::sqrt(sqDist) * GP::ANALYSIS::CORR_BIN_INV_W), GP::ANALYSIS::CORR_BINS - 1);
+                const double da = rod.a - ref.a;
+                bins.count[b] += 1.0;
+                bins.c2[b] += std::cos(2.0 * da);
+                bins.c4[b] += std::cos(4.0 * da);
+                bins.cS[b] += std::cos(K * (cos_ref * dx + sin_ref * dy))
+                            + std::cos(K * (std::cos(rod.a) * dx + std::sin(rod.a) * dy));
+            });
+    }
+}
+
+auto Correlations::accumulate(const std::array<Rod, GP::NUM_RODS>& rods) -> void
+{
+    m_cells.build(rods);
+
+    // The barriers publish m_frame and the cell list to the workers, and their bins back
+    m_frame = &rods;
+    m_start.arrive_and_wait();
+    accumulateThread(0);
+    m_done.arrive_and_wait();
+    m_frame = nullptr;
+
+    std::ranges::for_each(m_threadBins, [&](const CorrelationBins& bins) { m_bins.merge(bins); });
+    ++m_frames;
+}
+
+[[maybe_unused]] auto Correlations::accumulate(const std::filesystem::path& filename) -> bool
+{
+    AnnularCell cell{};
+    if (cell.fillFromFile(filename))
+    {
+        accumulate(cell.getRods());
+        return true;
+    }
+    return false;
+}
+
+[[maybe_unused]] auto Correlations::accumulate(const std::vector<std::filesystem::path>& filenames) -> int
+{
+    return static_cast<int>(std::ranges::count_if(filenames, [&](const std::filesystem::path& filename) { return accumulate(filename); }));
+}
+
+[[maybe_unused]] auto Correlations::accumulate(TrajectoryReader& trajectory) -> int
+{
+    int frames{ 0 };
+    std::array<Rod, GP::NUM_RODS> rods{};
+    while (trajectory.read(rods))
+    {
+        accumulate(rods);
+        ++frames;
+    }
+    return frames;
+}
+
+[[nodiscard]] auto Correlations::getNumFrames() const -> int
+{
+    return m_frames;
+}
+
+[[nodiscard]] auto Correlations::getBins() const -> const CorrelationBins&
+{
+    return m_bins;
+}
+
+[[maybe_unused]] auto Correlations::save(const std::filesystem::path& filename) const -> bool
+{
+    std::ofstream of(filename);
+
+    if (of.is_open())
+    {
+        constexpr double RHO = GP::NUM_RODS / (pi * (GP::CELL::R_OUT_SQ - GP::CELL::R_IN_SQ));
+
+        of << std::scientific << std::setprecision(15);
+        for (int b = 0; b < GP::ANALYSIS::CORR_BINS; ++b)
+        {
+            const double r_min = b * GP::ANALYSIS::CORR_BIN_W;
+            const double r_max = r_min + GP::ANALYSIS::CORR_BIN_W;
+            const double ideal = 0.5 * m_frames * GP::NUM_RODS * RHO * pi * (r_max * r_max - r_min * r_min);
+            const double n = m_bins.count[b];
+
+            of << 0.5 * (r_min + r_max) << ","
+               << (ideal > 0.0 ? n / ideal : 0.0) << ","
+               << (n > 0.0 ? m_bins.c2[b] / n : 0.0) << ","
+               << (n > 0.0 ? m_bins.c4[b] / n : 0.0) << ","
+               << (n > 0.0 ? 0.5 * m_bins.cS[b] / n : 0.0) << '\n';
+        }
+        of.close();
+
+        return true;
+    }
+    else
+    {
+        std::cout << "FILE " << filename << " COULD NOT BE OPENED!\n";
+        return false;
+    }
+}
+
+auto Correlations::reset() -> void
+{
+    m_bins.clear();
+    m_frames = 0;
+}
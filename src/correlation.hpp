@@ -0,0 +1,71 @@
+#pragma once
+
+#include "annularCell.hpp"
+#include "cellList.hpp"
+#include "trajectory.hpp"
+#include <vector>
+#include <barrier>
+#include <thread>
+
+/* Radial histograms of pairs of rods closer than GP::ANALYSIS::R_CORR.
+	- count: number of pairs in the bin
+	- c2, c4: sums of cos(2 da) and cos(4 da)
+	- cS: sums of cos(2 pi Q r.n), with n the director of each rod of the pair
+ */
+struct CorrelationBins {
+	std::vector<double> count = std::vector<double>(GP::ANALYSIS::CORR_BINS);
+	std::vector<double> c2 = std::vector<double>(GP::ANALYSIS::CORR_BINS);
+	std::vector<double> c4 = std::vector<double>(GP::ANALYSIS::CORR_BINS);
+	std::vector<double> cS = std::vector<double>(GP::ANALYSIS::CORR_BINS);
+
+	auto merge(const CorrelationBins& other) -> void;
+	auto clear() -> void;
+};
+
+/* Pair g(r), orientational g2(r), g4(r) and smectic gS(r) correlation functions,
+   averaged over any number of frames.
+	- Frames are accumulated one at a time, so memory does not grow with the trajectory length.
+	- Pairs are found through a cell list of width >= GP::ANALYSIS::R_CORR.
+	- The calling thread and hardware_concurrency() - 1 persistent workers each fill their own bins,
+	  which are merged at the end of every frame.
+ */
+class Correlations {
+public:
+	Correlations();
+	~Correlations();
+	Correlations(const Correlations&) = delete;
+	auto operator=(const Correlations&) -> Correlations& = delete;
+
+	auto accumulate(const std::array<Rod, GP::NUM_RODS>& rods) -> void;
+	[[maybe_unused]] auto accumulate(const std::filesystem::path& filename) -> bool;
+	[[maybe_unused]] auto accumulate(const std::vector<std::filesystem::path>& filenames) -> int;
+	[[maybe_unused]] auto accumulate(TrajectoryReader& trajectory) -> int; // Remaining frames of trajectory
+
+	[[nodiscard]] auto getNumFrames() const -> int;
+	[[nodiscard]] auto getBins() const -> const CorrelationBins&;
+
+	/* Writes one line per radial bin: r,g,g2,g4,gS
+		- g is normalized with the mean density of the annulus, so it is not corrected for wall effects.
+	 */
+	[[maybe_unused]] auto save(const std::filesystem::path& filename) const -> bool;
+	auto reset() -> void;
+
+private:
+	auto accumulateRange(const std::array<Rod, GP::NUM_RODS>& rods, const int begin, const int end, CorrelationBins& bins) const -> void;
+	auto accumulateThread(const int t) -> void; // Range t of m_frame into m_threadBins[t]
+	auto work(const int t) -> void;             // Worker loop, one frame per round of m_start and m_done
+
+private:
+	CorrelationBins m_bins{};
+	int m_frames{ 0 };
+
+	CellList m_cells{ GP::ANALYSIS::R_CORR }; // Reused between frames
+
+	const int m_numThreads;
+	std::vector<CorrelationBins> m_threadBins{}; // Reused between frames
+	const std::array<Rod, GP::NUM_RODS>* m_frame{ nullptr };
+	bool m_stopping{ false };
+	std::barrier<> m_start;
+	std::barrier<> m_done;
+	std::vector<std::jthread> m_workers{}; // Last, so that they are joined before the rest is destroyed
+};
@@ -0,0 +1,193 @@
+#include "csvLoader.hpp"
+#include <algorithm>
+#include <charconv>
+#include <iostream>
+#include <ranges>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+[[nodiscard]] auto LoadReport::isValid() const -> bool
+{
+    return opened && numRods == GP::NUM_RODS && parseErrors.empty() && outsideWalls.empty() && overlaps.empty();
+}
+
+auto LoadReport::print(const std::filesystem::path& filename) const -> void
+{
+    constexpr std::size_t MAX_LISTED{ 10 };
+
+    if (!opened)
+    {
+        std::cout << "FILE " << filename << " COULD NOT BE OPENED!\n";
+        return;
+    }
+    if (numRods != GP::NUM_RODS)
+    {
+        std::cout << "FILE " << filename << ": " << numRods << " rods read, " << GP::NUM_RODS << " expected.\n";
+    }
+    if (!parseErrors.empty())
+    {
+        std::cout << "FILE " << filename << ": " << parseErrors.size() << " malformed lines.\n";
+        std::ranges::for_each(parseErrors | std::views::take(MAX_LISTED),
+                              [](const ParseError& e) { std::cout << "  line " << e.line << ": " << e.message << '\n'; });
+    }
+    if (!outsideWalls.empty())
+    {
+        std::cout << "FILE " << filename << ": " << outsideWalls.size() << " rods outside the walls.\n";
+        std::ranges::for_each(outsideWalls | std::views::take(MAX_LISTED),
+                              [](const int i) { std::cout << "  rod " << i << " (line " << i + 1 << ")\n"; });
+    }
+    if (!overlaps.empty())
+    {
+        std::cout << "FILE " << filename << ": " << overlaps.size() << " overlapping pairs.\n";
+        std::ranges::for_each(overlaps | std::views::take(MAX_LISTED),
+                              [](const std::pair<int, int>& p) { std::cout << "  rods " << p.first << " and " << p.second << '\n'; });
+    }
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+auto MappedFile::close() -> void
+{
+#ifdef _WIN32
+    if (m_data != nullptr) { UnmapViewOfFile(m_data); }
+    if (m_mapping != nullptr) { CloseHandle(m_mapping); }
+    if (m_file != nullptr) { CloseHandle(m_file); }
+    m_mapping = nullptr;
+    m_file = nullptr;
+#else
+    if (m_data != nullptr) { munmap(const_cast<char*>(m_data), m_size); }
+#endif
+    m_data = nullptr;
+    m_size = 0;
+}
+
+[[nodiscard]] auto MappedFile::open(const std::filesystem::path& filename) -> bool
+{
+    close();
+
+    std::error_code ec;
+    m_size = static_cast<std::size_t>(std::filesystem::file_size(filename, ec));
+    if (ec)
+    {
+        return false;
+    }
+    if (m_size == 0)
+    {   // Nothing to map
+        return true;
+    }
+
+#ifdef _WIN32
+    HANDLE file = CreateFileW(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+    m_file = file;
+    m_mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (m_mapping == nullptr)
+    {
+        return false;
+    }
+    m_data = static_cast<const char*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+    return m_data != nullptr;
+#else
+    const int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+    void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // The mapping keeps the file alive
+    if (data == MAP_FAILED)
+    {
+        return false;
+    }
+    madvise(data, m_size, MADV_SEQUENTIAL);
+    m_data = static_cast<const char*>(data);
+    return true;
+#endif
+}
+
+[[nodiscard]] auto MappedFile::view() const -> std::string_view
+{
+    return (m_data != nullptr) ? std::string_view{ m_data, m_size } : std::string_view{};
+}
+
+inline static auto isBlank(const char c) -> bool
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+static auto parseLine(std::string_view line, Rod& rod) -> std::string_view
+{
+    const char* p = line.data();
+    const char* const end = p + line.size();
+    const auto skipBlanks = [&]() { while (p < end && isBlank(*p)) { ++p; } };
+
+    double* const fields[3]{ &rod.x, &rod.y, &rod.a };
+    constexpr std::string_view ERRORS[3]{ "could not read x", "could not read y", "could not read a" };
+    for (int f = 0; f < 3; ++f)
+    {
+        skipBlanks();
+        const auto [ptr, ec] = std::from_chars(p, end, *fields[f]);
+        if (ec != std::errc{})
+        {
+            return ERRORS[f];
+        }
+        p = ptr;
+        skipBlanks();
+        if (f < 2)
+        {
+            if (p == end || *p != ',')
+            {
+                return "expected x,y,a";
+            }
+            ++p;
+        }
+    }
+    if (p != end)
+    {
+        return "unexpected characters after a";
+    }
+    if (!std::isfinite(rod.x) || !std::isfinite(rod.y) || !std::isfinite(rod.a))
+    {   // from_chars accepts nan and inf
+        return "non-finite value";
+    }
+
+    if (std::abs(rod.a) > 0.5 * std::numbers::pi)
+    {
+        rod.a = std::remainder(rod.a, std::numbers::pi);
+    }
+    return {};
+}
+
+[[nodiscard]] auto parseRods(std::string_view text, std::span<Rod> rods, LoadReport& report) -> int
+{
+    int line = 0;
+    for (; !text.empty() && line < static_cast<int>(rods.size()); ++line)
+    {
+        const std::size_t eol = std::min(text.find('\n'), text.size());
+        Rod& rod = rods[line];
+        rod.index = line;
+        const std::string_view error = parseLine(text.substr(0, eol), rod);
+        if (!error.empty())
+        {
+            report.parseErrors.push_back({ line + 1, std::string(error) });
+        }
+        text.remove_prefix(std::min(eol + 1, text.size()));
+    }
+    return line;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "GlobalParameters.hpp" // includes <cmath>, <numbers> and <filesystem>
+#include "rod.hpp"
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/* Problems found while loading a configuration.
+	- Lines are counted from 1, rods from 0 (rod i is on line i + 1).
+ */
+struct LoadReport {
+	struct ParseError {
+		int line;
+		std::string message;
+	};
+
+	bool opened{ false };
+	int numRods{ 0 };
+	std::vector<ParseError> parseErrors{};
+	std::vector<int> outsideWalls{};
+	std::vector<std::pair<int, int>> overlaps{};
+
+	[[nodiscard]] auto isValid() const -> bool;
+	auto print(const std::filesystem::path& filename) const -> void;
+};
+
+/* Read-only memory map of a whole file. */
+class MappedFile {
+public:
+	MappedFile() = default;
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	~MappedFile();
+
+	[[nodiscard]] auto open(const std::filesystem::path& filename) -> bool;
+	[[nodiscard]] auto view() const -> std::string_view;
+
+private:
+	auto close() -> void;
+
+private:
+	const char* m_data{ nullptr };
+	std::size_t m_size{ 0 };
+#ifdef _WIN32
+	void* m_file{ nullptr };
+	void* m_mapping{ nullptr };
+#endif
+};
+
+/* Parses lines of the form x,y,a into rods, without copying the text.
+	- Only up to rods.size() lines are parsed, further lines are ignored.
+	- Values must be finite. Angles are brought back to [-HALF_PI, HALF_PI].
+	- Returns the number of lines read, malformed ones included.
+ */
+[[nodiscard]] auto parseRods(std::string_view text, std::span<Rod> rods, LoadReport& report) -> int;
@@ -8,6 +8,12 @@
 	return GP::GRID::CENTRAL_INDEX + static_cast<int>(std::round(x * GP::GRID::BOX_INV_W) - std::round(y * GP::GRID::BOX_INV_W) * GP::GRID::BOXES_PER_SIDE);
 }
 
+[[nodiscard]] auto Grid::isWithinFrame(const double& x, const double& y) const -> bool
+{
+	// The empty frame around the cell keeps the stencils of these points within the grid
+	return std::abs(x) <= GP::CELL::R_OUT && std::abs(y) <= GP::CELL::R_OUT;
+}
+
 auto Grid::addIndexAt(const int idx, const double& x, const double& y) -> void
 {
 	m_boxes[getBoxIndexAt(x, y)].emplace_front(idx);
@@ -3,23 +3,30 @@
 #include "GlobalParameters.hpp" // includes <cmath> and <numbers>
 #include <array>
 #include <forward_list>
+#include <utility>
+#include <algorithm>
 
-consteval std::array<std::array<int, 9>, GP::GRID::NUM_BOXES> setNeighborBoxes() 
+consteval std::array<int, GP::GRID::STENCIL_SIZE> setStencilOffsets()
 {
-    // Evaluates at compile time the neighboring index of a box
-    // Note that the boundaries are *not* treated differently
-    std::array<std::array<int, 9>, GP::GRID::NUM_BOXES> neighborBoxes{};
-    for (int i = 0; i < GP::GRID::NUM_BOXES; ++i)
+    // Evaluates at compile time the index offsets of the boxes within GP::GRID::REACH of a box
+    // Note that the boundaries are *not* treated differently, so these are the same for every box
+    std::array<int, GP::GRID::STENCIL_SIZE> offsets{};
+    int n = 0;
+    // The order is by increasing distance (central box first)
+    for (int ring = 0; ring <= GP::GRID::REACH; ++ring)
     {
-        // The order is in *inverse* probability (central box last)
-        // because the function getNeighborhoodOf() returns a push_front of the forward_lists
-        neighborBoxes[i] = { i, i - 1, i + 1,
-                             i - GP::GRID::BOXES_PER_SIDE, i + GP::GRID::BOXES_PER_SIDE,
-                             i - 1 + GP::GRID::BOXES_PER_SIDE, i + 1 + GP::GRID::BOXES_PER_SIDE,
-                             i - 1 - GP::GRID::BOXES_PER_SIDE, i + 1 - GP::GRID::BOXES_PER_SIDE };
-
+        for (int dy = -ring; dy <= ring; ++dy)
+        {
+            for (int dx = -ring; dx <= ring; ++dx)
+            {
+                if (dx == -ring || dx == ring || dy == -ring || dy == ring)
+                {
+                    offsets[n++] = dx + dy * GP::GRID::BOXES_PER_SIDE;
+                }
+            }
+        }
     }
-    return neighborBoxes;
+    return offsets;
 };
 
 class Grid
@@ -27,14 +34,50 @@ class Grid
 public:
 
     [[nodiscard]] auto getBoxIndexAt(const double& x, const double& y) const -> int;
-    
+    [[nodiscard]] auto isWithinFrame(const double& x, const double& y) const -> bool; // False for non-finite coordinates
+
     auto addIndexAt(const int idx, const double& x, const double& y) -> void;
     auto moveIndex(const int idx, const double& from_x, const double& from_y, const double& to_x, const double& to_y) -> void;
 
+    /* Position-aware reduced stencil: calls pred(box) for the boxes that may hold the center of a rod
+       overlapping a rod centered at (x, y), i.e. those closer than a rod diagonal to it.
+       Stops, and returns true, as soon as pred returns true.
+     */
+    template <typename Pred>
+    auto anyBoxNear(const double& x, const double& y, Pred&& pred) const -> bool
+    {
+        return anyBoxWithin(x, y, GP::ROD::D, std::forward<Pred>(pred));
+    }
+
+    // Same, for the boxes closer than radius to (x, y). Requires radius < GP::GRID::REACH * GP::GRID::BOX_W
+    template <typename Pred>
+    auto anyBoxWithin(const double& x, const double& y, const double& radius, Pred&& pred) const -> bool
+    {
+        const int col_min = static_cast<int>(std::round((x - radius) * GP::GRID::BOX_INV_W));
+        const int col_max = static_cast<int>(std::round((x + radius) * GP::GRID::BOX_INV_W));
+        const int row_min = static_cast<int>(std::round((y - radius) * GP::GRID::BOX_INV_W));
+        const int row_max = static_cast<int>(std::round((y + radius) * GP::GRID::BOX_INV_W));
+        const double radius_sq = radius * radius;
+
+        for (int row = row_min; row <= row_max; ++row)
+        {
+            const double dy = std::max(0.0, std::abs(y - row * GP::GRID::BOX_W) - GP::GRID::HALF_BOX_W);
+            for (int col = col_min; col <= col_max; ++col)
+            {
+                // Skip corner boxes entirely beyond radius
+                const double dx = std::max(0.0, std::abs(x - col * GP::GRID::BOX_W) - GP::GRID::HALF_BOX_W);
+                if (dx * dx + dy * dy <= radius_sq && pred(GP::GRID::CENTRAL_INDEX + col - row * GP::GRID::BOXES_PER_SIDE))
+                {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
 //private:
 
     std::array<std::forward_list<int>, GP::GRID::NUM_BOXES> m_boxes{};
-    static constexpr std::array<std::array<int, 9>, GP::GRID::NUM_BOXES> m_neighborBoxesIndexes{ setNeighborBoxes() };
+    static constexpr std::array<int, GP::GRID::STENCIL_SIZE> m_stencilOffsets{ setStencilOffsets() };
 
 };
-
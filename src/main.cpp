@@ -1,81 +1,311 @@
 #include <iostream>
 #include <format>
 #include <chrono>
+#include <ranges>
+#include <string>
+#include <string_view>
+#include <algorithm>
+#include <vector>
+#include <charconv>
 #include "annularCell.hpp"
 #include "analysis.hpp"
-#include <fstream>
-#include <random>
+#include "correlation.hpp"
+#include "polarField.hpp"
+#include "trajectory.hpp"
+#include "snapshot.hpp"
+#include <memory>
+#include <thread>
 
-int main()
+using std::chrono::steady_clock;
+
+static auto printUsage() -> void
+{
+    std::cout << "Usage:\n"
+              << "  AnnularCell simulate [initial.csv]            Thermalize and run GP::MC::MC_ITERATIONS saved iterations,\n"
+              << "                                                from a new configuration or from initial.csv\n"
+              << "  AnnularCell field <initial.csv>               Run the simulation saving only the coarse-grained director field\n"
+              << "  AnnularCell trajectory <initial.csv>          Run the simulation saving a compressed trajectory\n"
+              << "  AnnularCell live <initial.csv> <out.csv>      Run the simulation computing correlations concurrently\n"
+              << "      field, trajectory and live start recording from initial.csv (e.g. a thermalized configuration),\n"
+              << "      unless --thermalize is given\n"
+              << "  AnnularCell analyze <in.csv|in.actr> <out>    Local directors and order parameters (out is a prefix for trajectories)\n"
+              << "  AnnularCell domains <in.csv> <out.csv> <defects.csv>\n"
+              << "  AnnularCell correlations <out.csv> <in.csv|in.actr>...\n"
+              << "  AnnularCell stencil <in.csv> [steps]            Overlap-check candidates per rod, and MC speed over steps\n";
+}
+
+static auto usageError() -> int
+{
+    printUsage();
+    return 1;
+}
+
+// Removes flag from args, returning whether it was there
+static auto takeFlag(std::vector<std::string_view>& args, const std::string_view flag) -> bool
+{
+    return std::erase(args, flag) > 0;
+}
+
+static auto fillCell(AnnularCell& cell, const std::vector<std::string_view>& args) -> bool
+{
+    return args.empty() ? cell.fill() : cell.fillFromFile(args[0]);
+}
+
+static auto thermalize(AnnularCell& cell) -> void
+{
+    const steady_clock::time_point tic{ steady_clock::now() };
+    const double mean_acceptance = cell.equilibrate(); // Use cell.thermalize() for exactly GP::MC::THERMAL_STEPS steps
+    const steady_clock::time_point toc{ steady_clock::now() };
+
+    std::cout << std::format("Thermalization duration: {} s\n", 0.001 * std::chrono::duration_cast<std::chrono::milliseconds>(toc - tic).count());
+    std::cout << std::format("Mean acceptance: {}%\n", mean_acceptance);
+
+    cell.save(GP::IO::THERMALIZED, GP::NUM_RODS);
+}
+
+static auto simulate(const std::vector<std::string_view>& args) -> int
+{
+    AnnularCell cell{};
+    if (!fillCell(cell, args))
+    {
+        return 1;
+    }
+    thermalize(cell);
+
+    for (int iter = 0; iter < GP::MC::MC_ITERATIONS; ++iter)
+    {
+        const steady_clock::time_point tic{ steady_clock::now() };
+        const double mean_acceptance = cell.MCSimulation();
+        const steady_clock::time_point toc{ steady_clock::now() };
+
+        std::cout << std::format(" --- ITERATION {} OF {} --- \n", 1 + iter, GP::MC::MC_ITERATIONS);
+        std::cout << std::format("Duration: {} s\n", std::chrono::duration_cast<std::chrono::seconds>(toc - tic).count());
+        std::cout << std::format("Mean acceptance: {}%\n", mean_acceptance);
+        const Pressure pressure{ cell.getPressure() };
+        std::cout << std::format("Reduced pressure: bulk {}, outer wall {}, inner wall {}\n\n", pressure.bulk, pressure.outerWall, pressure.innerWall);
+        cell.resetPressure();
+
+        std::filesystem::path filename = GP::IO::MC_BASE;
+        (filename += std::to_string(iter)) += GP::IO::MC_EXT;
+        cell.save(filename, GP::NUM_RODS);
+    }
+    return 0;
+}
+
+static auto field(std::vector<std::string_view> args) -> int
+{
+    const bool thermalize_first = takeFlag(args, "--thermalize");
+    AnnularCell cell{};
+    PolarField field{};
+    if (args.size() != 1)
+    {
+        return usageError();
+    }
+    if (!cell.fillFromFile(args[0]) || !field.open(GP::FIELD::FILENAME))
+    {
+        return 1;
+    }
+    if (thermalize_first)
+    {
+        thermalize(cell);
+    }
+
+    cell.MCSteps(GP::MC::MC_STEPS * GP::MC::MC_ITERATIONS, [&](const int step, const double)
+        {
+            return (step % GP::FIELD::SAVE_INTERVAL != 0) || field.write(cell.getRods(), step);
+        });
+    return 0;
+}
+
+static auto trajectory(std::vector<std::string_view> args) -> int
+{
+    const bool thermalize_first = takeFlag(args, "--thermalize");
+    AnnularCell cell{};
+    TrajectoryWriter trajectory{};
+    if (args.size() != 1)
+    {
+        return usageError();
+    }
+    if (!cell.fillFromFile(args[0]) || !trajectory.open(GP::TRAJECTORY::FILENAME))
+    {
+        return 1;
+    }
+    if (thermalize_first)
+    {
+        thermalize(cell);
+    }
+
+    for (int iter = 0; iter < GP::MC::MC_ITERATIONS; ++iter)
+    {
+        cell.MCSimulation();
+        trajectory.write(cell.getRods());
+    }
+    return trajectory.close() ? 0 : 1;
+}
+
+static auto live(std::vector<std::string_view> args) -> int
 {
-    /* Create a new MC simulation __________________________________________ */
-    using std::chrono::steady_clock;
+    const bool thermalize_first = takeFlag(args, "--thermalize");
+    if (args.size() != 2)
+    {
+        return usageError();
+    }
 
     AnnularCell cell{};
-    if (cell.fill())
+    if (!cell.fillFromFile(args[0]))
+    {
+        return 1;
+    }
+    if (thermalize_first)
+    {
+        thermalize(cell);
+    }
+
+    // The analysis thread works on the latest snapshot while the simulation goes on
+    auto buffer = std::make_unique<SnapshotBuffer>();
+    Correlations correlations{};
+    cell.attachSnapshotBuffer(*buffer, GP::MC::SNAPSHOT_INTERVAL);
     {
-        steady_clock::time_point tic{ steady_clock::now() };
-        double mean_acceptance = cell.thermalize();
-        steady_clock::time_point toc{ steady_clock::now() };
-        
-        std::cout << std::format("Thermalization duration: {} s\n", 0.001 * std::chrono::duration_cast<std::chrono::milliseconds>(toc - tic).count());
+        std::jthread analysis([&](std::stop_token stop)
+            {
+                consumeSnapshots(*buffer, stop, [&](const Snapshot& snapshot) { correlations.accumulate(snapshot.rods); });
+            });
+
+        const double mean_acceptance = cell.MCSteps(GP::MC::MC_STEPS * GP::MC::MC_ITERATIONS);
         std::cout << std::format("Mean acceptance: {}%\n", mean_acceptance);
+        cell.detachSnapshotBuffers();
+        analysis.join(); // Lets it analyze the last snapshot, instead of requesting it to stop
+    }
+
+    std::cout << std::format("Frames accumulated: {}\n", correlations.getNumFrames());
+    cell.save(GP::IO::MC_BASE.string() + "final" + GP::IO::MC_EXT.string(), GP::NUM_RODS);
+    return correlations.save(args[1]) ? 0 : 1;
+}
 
-        cell.save(GP::IO::THERMALIZED, GP::NUM_RODS);
+static auto analyze(const std::vector<std::string_view>& args) -> int
+{
+    if (args.size() != 2)
+    {
+        return usageError();
+    }
 
-        for (int iter = 0; iter < GP::MC::MC_ITERATIONS; ++iter)
+    Analysis analysis{};
+    const std::filesystem::path file_in{ args[0] };
+    if (file_in.extension() == GP::TRAJECTORY::FILENAME.extension())
+    {
+        TrajectoryReader trajectory{};
+        if (!trajectory.open(file_in))
+        {
+            return 1;
+        }
+        for (int frame = 0; frame < trajectory.getNumFrames(); ++frame)
         {
-            tic = steady_clock::now();
-            double mean_acceptance = cell.MCSimulation();
-            toc = steady_clock::now();
+            std::filesystem::path filename{ args[1] };
+            (filename += std::to_string(frame)) += GP::IO::MC_EXT;
+            analysis.analize(trajectory, filename);
+        }
+    }
+    else
+    {
+        analysis.analize(file_in, args[1]);
+    }
+    return 0;
+}
 
-            std::cout << std::format(" --- ITERATION {} OF {} --- \n",1 + iter, GP::MC::MC_ITERATIONS);
-            std::cout << std::format("Duration: {} s\n", std::chrono::duration_cast<std::chrono::seconds>(toc - tic).count());
-            std::cout << std::format("Mean acceptance: {}%\n\n", mean_acceptance);
+static auto domains(const std::vector<std::string_view>& args) -> int
+{
+    if (args.size() != 3)
+    {
+        return usageError();
+    }
 
-            std::filesystem::path filename = GP::IO::MC_BASE;
-            (filename += std::to_string(iter)) += GP::IO::MC_EXT;
-            cell.save(filename, GP::NUM_RODS);
+    Analysis analysis{};
+    analysis.analizeDomains(args[0], args[1], args[2]);
+    return 0;
+}
+
+static auto correlations(const std::vector<std::string_view>& args) -> int
+{
+    if (args.size() < 2)
+    {
+        return usageError();
+    }
+
+    Correlations correlations{};
+    for (const std::filesystem::path file_in : args | std::views::drop(1))
+    {
+        if (file_in.extension() == GP::TRAJECTORY::FILENAME.extension())
+        {
+            TrajectoryReader trajectory{};
+            if (trajectory.open(file_in))
+            {
+                correlations.accumulate(trajectory);
+            }
+        }
+        else
+        {
+            correlations.accumulate(file_in);
         }
     }
+    std::cout << std::format("Frames accumulated: {}\n", correlations.getNumFrames());
+    return correlations.save(args[0]) ? 0 : 1;
+}
+
+static auto stencil(const std::vector<std::string_view>& args) -> int
+{
+    if (args.empty() || args.size() > 2)
+    {
+        return usageError();
+    }
+    int steps{ 1000 };
+    if (args.size() == 2)
+    {
+        const auto [ptr, ec] = std::from_chars(args[1].data(), args[1].data() + args[1].size(), steps);
+        if (ec != std::errc{} || ptr != args[1].data() + args[1].size() || steps < 1)
+        {
+            return usageError();
+        }
+    }
+
+    AnnularCell cell{};
+    if (!cell.fillFromFile(args[0]))
+    {
+        return 1;
+    }
+
+    const StencilStatistics stats{ cell.getStencilStatistics() };
+    std::cout << std::format("Grid: {} boxes per side, box width {}, reach {}\n", GP::GRID::BOXES_PER_SIDE, GP::GRID::BOX_W, GP::GRID::REACH);
+    std::cout << std::format("Full stencil:    {:6.2f} boxes, {:7.2f} candidates per rod\n", stats.fullBoxes, stats.fullCandidates);
+    std::cout << std::format("Reduced stencil: {:6.2f} boxes, {:7.2f} candidates per rod\n", stats.reducedBoxes, stats.reducedCandidates);
+    std::cout << std::format("Within diagonal: {:22.2f} rods per rod\n", stats.withinD);
+    std::cout << std::format("Overlap check:   {:6.1f} ns full, {:6.1f} ns reduced, using {}\n",
+        stats.fullNs, stats.reducedNs, (GP::GRID::REACH <= 2) ? "full" : "reduced");
+
+    const steady_clock::time_point tic{ steady_clock::now() };
+    const double mean_acceptance = cell.MCSteps(steps);
+    const steady_clock::time_point toc{ steady_clock::now() };
+    std::cout << std::format("MC: {} us per step, mean acceptance {}%\n",
+        std::chrono::duration_cast<std::chrono::microseconds>(toc - tic).count() / steps, mean_acceptance);
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        return usageError();
+    }
 
+    const std::string_view command{ argv[1] };
+    const std::vector<std::string_view> args(argv + 2, argv + argc);
 
-    /* Continue MC simulation on saved configuration _______________________ */
-    // using std::chrono::steady_clock;
-    //
-    // AnnularCell cell{};
-    // if (cell.fillFromFile(GP::IO::INITIAL))
-    // {
-    //     steady_clock::time_point tic{ steady_clock::now() };
-    //     double mean_acceptance = cell.thermalize();
-    //     steady_clock::time_point toc{ steady_clock::now() };
-    //        
-    //     std::cout << std::format("Thermalization duration: {} s\n", 0.001 * std::chrono::duration_cast<std::chrono::milliseconds>(toc - tic).count());
-    //     std::cout << std::format("Mean acceptance: {}%\n", mean_acceptance);
-    //
-    //     cell.save(GP::IO::THERMALIZED, GP::NUM_RODS);
-    //
-    //     for (int iter = 0; iter < GP::MC::MC_ITERATIONS; ++iter)
-    //     {
-    //         tic = steady_clock::now();
-    //         double mean_acceptance = cell.MCSimulation();
-    //         toc = steady_clock::now();
-    //
-    //         std::cout << std::format(" --- ITERATION {} OF {} --- \n",1 + iter, GP::MC::MC_ITERATIONS);
-    //         std::cout << std::format("Duration: {} s\n", std::chrono::duration_cast<std::chrono::seconds>(toc - tic).count());
-    //         std::cout << std::format("Mean acceptance: {}%\n\n", mean_acceptance);
-    //
-    //         std::filesystem::path filename = GP::IO::MC_BASE;
-    //         (filename += std::to_string(iter)) += GP::IO::MC_EXT;
-    //         cell.save(filename, GP::NUM_RODS);
-    //     }
-    // }
-
-
-    /* Run analysis on saved configuration _________________________________ */
-    //const std::filesystem::path FILE_IN{ "initial_configuration.csv" };
-    //const std::filesystem::path FILE_OUT{ "analyzed_configuration.csv" };
-    //
-    //Analysis analysis{};
-    //analysis.analize(FILE_IN, FILE_OUT);
+    if (command == "simulate")     { return simulate(args); }
+    if (command == "field")        { return field(args); }
+    if (command == "trajectory")   { return trajectory(args); }
+    if (command == "live")         { return live(args); }
+    if (command == "analyze")      { return analyze(args); }
+    if (command == "domains")      { return domains(args); }
+    if (command == "correlations") { return correlations(args); }
+    if (command == "stencil")      { return stencil(args); }
+    return usageError();
 }
@@ -0,0 +1,147 @@
+#include "polarField.hpp"
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+using std::numbers::pi;
+
+static auto requirePositive(const int bins, const char* name) -> int
+{
+    if (bins <= 0)
+    {
+        throw std::invalid_argument(std::string("PolarField: ") + name + " must be positive, got " + std::to_string(bins));
+    }
+    return bins;
+}
+
+PolarField::PolarField(const int r_bins, const int theta_bins)
+    : m_rBins{ requirePositive(r_bins, "r_bins") },
+      m_thetaBins{ requirePositive(theta_bins, "theta_bins") },
+      m_rInvW{ r_bins / (GP::CELL::R_OUT - GP::CELL::R_IN) },
+      m_thetaInvW{ theta_bins / (2.0 * pi) },
+      m_density(r_bins * theta_bins),
+      m_cos2a(r_bins * theta_bins),
+      m_sin2a(r_bins * theta_bins),
+      m_q4(r_bins * theta_bins)
+{
+}
+
+[[nodiscard]] auto PolarField::getNumBins() const -> int
+{
+    return m_rBins * m_thetaBins;
+}
+
+[[nodiscard]] auto PolarField::getBinAt(const double& x, const double& y) const -> int
+{
+    const int ir = static_cast<int>((std::sqrt(x * x + y * y) - GP::CELL::R_IN) * m_rInvW);
+    if (ir < 0 || ir >= m_rBins)
+    {
+        return -1;
+    }
+    const int it = static_cast<int>((std::atan2(y, x) + pi) * m_thetaInvW) % m_thetaBins; // atan2 may return +pi
+    return ir * m_thetaBins + it;
+}
+
+auto PolarField::compute(const std::array<Rod, GP::NUM_RODS>& rods) -> void
+{
+    std::vector<int> count(getNumBins());
+    std::vector<double> cos2a(getNumBins());
+    std::vector<double> sin2a(getNumBins());
+    std::vector<double> cos4a(getNumBins());
+    std::vector<double> sin4a(getNumBins());
+
+    for (const Rod& rod : rods)
+    {
+        const int b = getBinAt(rod.x, rod.y);
+        if (b >= 0)
+        {
+            const double c = std::cos(2.0 * rod.a);
+            const double s = std::sin(2.0 * rod.a);
+            ++count[b];
+            cos2a[b] += c;
+            sin2a[b] += s;
+            cos4a[b] += c * c - s * s;
+            sin4a[b] += 2.0 * s * c;
+        }
+    }
+
+    const double dr = (GP::CELL::R_OUT - GP::CELL::R_IN) / m_rBins;
+    const double dtheta = 2.0 * pi / m_thetaBins;
+    for (int ir = 0; ir < m_rBins; ++ir)
+    {
+        const double r = GP::CELL::R_IN + (ir + 0.5) * dr;
+        const double area = r * dr * dtheta;
+        for (int it = 0; it < m_thetaBins; ++it)
+        {
+            const int b = ir * m_thetaBins + it;
+            const double n = (count[b] > 0) ? count[b] : 1.0;
+            m_density[b] = static_cast<float>(count[b] / area);
+            m_cos2a[b] = static_cast<float>(cos2a[b] / n);
+            m_sin2a[b] = static_cast<float>(sin2a[b] / n);
+            m_q4[b] = static_cast<float>(std::sqrt(cos4a[b] * cos4a[b] + sin4a[b] * sin4a[b]) / n);
+        }
+    }
+}
+
+[[nodiscard]] auto PolarField::getDensity() const -> const std::vector<float>&
+{
+    return m_density;
+}
+
+[[nodiscard]] auto PolarField::getCos2a() const -> const std::vector<float>&
+{
+    return m_cos2a;
+}
+
+[[nodiscard]] auto PolarField::getSin2a() const -> const std::vector<float>&
+{
+    return m_sin2a;
+}
+
+[[nodiscard]] auto PolarField::getQ4() const -> const std::vector<float>&
+{
+    return m_q4;
+}
+
+[[maybe_unused]] auto PolarField::open(const std::filesystem::path& filename) -> bool
+{
+    m_file.open(filename, std::ios::binary | std::ios::trunc);
+    if (m_file.is_open())
+    {
+        constexpr char MAGIC[4]{ 'A', 'C', 'P', 'F' };
+        constexpr std::uint32_t VERSION{ 1 };
+        const std::uint32_t r_bins = m_rBins;
+        const std::uint32_t theta_bins = m_thetaBins;
+
+        m_file.write(MAGIC, sizeof(MAGIC));
+        m_file.write(reinterpret_cast<const char*>(&VERSION), sizeof(VERSION));
+        m_file.write(reinterpret_cast<const char*>(&r_bins), sizeof(r_bins));
+        m_file.write(reinterpret_cast<const char*>(&theta_bins), sizeof(theta_bins));
+        m_file.write(reinterpret_cast<const char*>(&GP::CELL::R_IN), sizeof(GP::CELL::R_IN));
+        m_file.write(reinterpret_cast<const char*>(&GP::CELL::R_OUT), sizeof(GP::CELL::R_OUT));
+        return m_file.good();
+    }
+    else
+    {
+        std::cout << "FILE " << filename << " COULD NOT BE OPENED!\n";
+        return false;
+    }
+}
+
+[[maybe_unused]] auto PolarField::write(const std::array<Rod, GP::NUM_RODS>& rods, const std::int64_t step) -> bool
+{
+    if (!m_file.is_open())
+    {
+        return false;
+    }
+
+    compute(rods);
+
+    const auto writeFloats = [&](const std::vector<float>& v) { m_file.write(reinterpret_cast<const char*>(v.data()), v.size() * sizeof(float)); };
+    m_file.write(reinterpret_cast<const char*>(&step), sizeof(step));
+    writeFloats(m_density);
+    writeFloats(m_cos2a);
+    writeFloats(m_sin2a);
+    writeFloats(m_q4);
+    return m_file.good();
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "GlobalParameters.hpp" // includes <cmath>, <numbers> and <filesystem>
+#include "rod.hpp"
+#include <array>
+#include <cstdint>
+#include <fstream>
+#include <vector>
+
+/* Coarse-grained director field on a polar (r, theta) mesh over R_IN..R_OUT.
+	Each bin holds the number density of rod centers, <cos 2a>, <sin 2a> and q4 = |<exp(4ia)>|.
+
+	Binary file layout (native byte order):
+	- Header: char[4] "ACPF", uint32 version, uint32 r_bins, uint32 theta_bins, float64 R_IN, float64 R_OUT
+	- Frame:  int64 step, then float32 density[n], cos2a[n], sin2a[n], q4[n],
+	          with n = r_bins * theta_bins and bin index ir * theta_bins + itheta
+ */
+class PolarField {
+public:
+	// Throws std::invalid_argument unless both numbers of bins are positive
+	explicit PolarField(const int r_bins = GP::FIELD::R_BINS, const int theta_bins = GP::FIELD::THETA_BINS);
+
+	auto compute(const std::array<Rod, GP::NUM_RODS>& rods) -> void;
+
+	[[nodiscard]] auto getNumBins() const -> int;
+	[[nodiscard]] auto getBinAt(const double& x, const double& y) const -> int; // -1 outside the annulus
+	[[nodiscard]] auto getDensity() const -> const std::vector<float>&;
+	[[nodiscard]] auto getCos2a() const -> const std::vector<float>&;
+	[[nodiscard]] auto getSin2a() const -> const std::vector<float>&;
+	[[nodiscard]] auto getQ4() const -> const std::vector<float>&;
+
+	/* Opens filename and writes the header. Frames are then appended by write(). */
+	[[maybe_unused]] auto open(const std::filesystem::path& filename) -> bool;
+	[[maybe_unused]] auto write(const std::array<Rod, GP::NUM_RODS>& rods, const std::int64_t step) -> bool;
+
+private:
+	int m_rBins;
+	int m_thetaBins;
+	double m_rInvW;
+	double m_thetaInvW;
+
+	std::vector<float> m_density;
+	std::vector<float> m_cos2a;
+	std::vector<float> m_sin2a;
+	std::vector<float> m_q4;
+
+	std::ofstream m_file{};
+};
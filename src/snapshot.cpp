@@ -0,0 +1,66 @@
+#include "snapshot.hpp"
+#include <chrono>
+#include <thread>
+
+auto SnapshotBuffer::publish(const std::array<Rod, GP::NUM_RODS>& rods, const std::int64_t step) -> void
+{
+    Snapshot& slot = m_slots[m_back];
+    slot.rods = rods;
+    slot.step = step;
+
+    const std::uint8_t previous = m_shared.exchange(m_back | FRESH, std::memory_order_acq_rel);
+    m_back = previous & INDEX_MASK;
+}
+
+auto SnapshotBuffer::close() -> void
+{
+    m_closed.store(true, std::memory_order_release);
+}
+
+[[nodiscard]] auto SnapshotBuffer::acquire() -> bool
+{
+    if ((m_shared.load(std::memory_order_relaxed) & FRESH) == 0)
+    {
+        return false;
+    }
+    const std::uint8_t previous = m_shared.exchange(m_front, std::memory_order_acq_rel);
+    m_front = previous & INDEX_MASK;
+    return true;
+}
+
+[[nodiscard]] auto SnapshotBuffer::front() const -> const Snapshot&
+{
+    return m_slots[m_front];
+}
+
+[[nodiscard]] auto SnapshotBuffer::isClosed() const -> bool
+{
+    return m_closed.load(std::memory_order_acquire);
+}
+
+auto consumeSnapshots(SnapshotBuffer& buffer, std::stop_token stop, const std::function<void(const Snapshot&)>& f) -> int
+{
+    int consumed{ 0 };
+    while (!stop.stop_requested())
+    {
+        if (buffer.acquire())
+        {
+            f(buffer.front());
+            ++consumed;
+        }
+        else if (buffer.isClosed())
+        {   // A last snapshot may have been published just before closing
+            if (buffer.acquire())
+            {
+                f(buffer.front());
+                ++consumed;
+            }
+            break;
+        }
+        else
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    }
+    return consumed;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "GlobalParameters.hpp" // includes <cmath>, <numbers> and <filesystem>
+#include "rod.hpp"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <stop_token>
+
+struct Snapshot {
+	std::array<Rod, GP::NUM_RODS> rods;
+	std::int64_t step;
+};
+
+/* Lock-free triple buffer of snapshots, between one publisher (the simulation) and one consumer.
+	- publish() never waits: it writes into a free slot and swaps it with the shared one.
+	- acquire() swaps the shared slot into front() if a newer snapshot was published since the last call.
+	Snapshots the consumer is too slow to take are dropped, only the latest one is kept.
+	Use one SnapshotBuffer per consumer thread. Each one holds three copies of the rods, so allocate it on the heap.
+ */
+class SnapshotBuffer {
+public:
+	auto publish(const std::array<Rod, GP::NUM_RODS>& rods, const std::int64_t step) -> void;
+	auto close() -> void; // No more snapshots will be published
+
+	[[nodiscard]] auto acquire() -> bool;
+	[[nodiscard]] auto front() const -> const Snapshot&;
+	[[nodiscard]] auto isClosed() const -> bool;
+
+private:
+	static constexpr std::uint8_t INDEX_MASK{ 0b011 };
+	static constexpr std::uint8_t FRESH{ 0b100 };
+
+	std::array<Snapshot, 3> m_slots{};
+	alignas(64) std::atomic<std::uint8_t> m_shared{ 1 };
+	alignas(64) std::uint8_t m_back{ 0 };    // Only touched by the publisher
+	alignas(64) std::uint8_t m_front{ 2 };   // Only touched by the consumer
+	std::atomic<bool> m_closed{ false };
+};
+
+/* Calls f(snapshot) for every snapshot acquired from buffer, until it is closed and drained or stop is requested.
+   Meant to be the body of an analysis thread.
+ */
+auto consumeSnapshots(SnapshotBuffer& buffer, std::stop_token stop, const std::function<void(const Snapshot&)>& f) -> int;
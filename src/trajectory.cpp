@@ -0,0 +1,500 @@
+#include "trajectory.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <string_view>
+
+constexpr std::string_view MAGIC{ "ACTR" };
+constexpr std::string_view INDEX_MAGIC{ "ACTI" };
+constexpr std::uint32_t VERSION{ 1 };
+constexpr std::size_t HEADER_BYTES{ 40 };
+constexpr std::size_t FRAME_HEADER_BYTES{ 8 };
+constexpr std::size_t TRAILER_BYTES{ 16 };
+constexpr std::uint32_t MIN_PAYLOAD_WORDS{ (3 * GP::NUM_RODS + 63) / 64 + 1 }; // At least one bit per code, plus the padding word
+constexpr int ESCAPE{ 32 }; // Rice quotients from here on are stored as raw 64-bit values
+
+inline static auto zigzag(const std::int64_t v) -> std::uint64_t
+{
+    return (static_cast<std::uint64_t>(v) << 1) ^ static_cast<std::uint64_t>(v >> 63);
+}
+
+inline static auto unzigzag(const std::uint64_t u) -> std::int64_t
+{
+    return static_cast<std::int64_t>((u >> 1) ^ (~(u & 1) + 1));
+}
+
+inline static auto lowBits(const std::uint64_t v, const int n) -> std::uint64_t
+{
+    return (n >= 64) ? v : v & ((std::uint64_t{ 1 } << n) - 1);
+}
+
+template <typename T>
+inline static auto readAt(std::string_view data, const std::size_t offset) -> T
+{
+    T value;
+    std::memcpy(&value, data.data() + offset, sizeof(T));
+    return value;
+}
+
+template <typename T>
+inline static auto writeRaw(std::ofstream& file, const T& value) -> void
+{
+    file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+// LSB-first bit packing into 64-bit words
+class BitWriter
+{
+public:
+    explicit BitWriter(std::vector<std::uint64_t>& words) : m_words{ words } {}
+
+    auto write(std::uint64_t v, const int n) -> void
+    {
+        if (n == 0)
+        {
+            return;
+        }
+        v = lowBits(v, n);
+        m_acc |= v << m_used;
+        if (m_used + n >= 64)
+        {
+            m_words.push_back(m_acc);
+            m_acc = (m_used == 0) ? 0 : v >> (64 - m_used);
+            m_used += n - 64;
+        }
+        else
+        {
+            m_used += n;
+        }
+    }
+
+    auto writeRice(const std::uint64_t u, const int k) -> void
+    {
+        const std::uint64_t q = u >> k;
+        if (q < ESCAPE)
+        {
+            write(std::uint64_t{ 1 } << q, static_cast<int>(q) + 1);
+            write(u, k);
+        }
+        else
+        {
+            write(std::uint64_t{ 1 } << ESCAPE, ESCAPE + 1);
+            write(u, 64);
+        }
+    }
+
+    auto flush() -> void
+    {
+        if (m_used > 0)
+        {
+            m_words.push_back(m_acc);
+        }
+        m_words.push_back(0); // Lets the reader always load two words
+        m_acc = 0;
+        m_used = 0;
+    }
+
+private:
+    std::vector<std::uint64_t>& m_words;
+    std::uint64_t m_acc{ 0 };
+    int m_used{ 0 };
+};
+
+class BitReader
+{
+public:
+    BitReader(const char* data, const std::size_t num_words) : m_data{ data }, m_numWords{ num_words } {}
+
+    auto read(const int n) -> std::uint64_t
+    {
+        if (n == 0)
+        {
+            return 0;
+        }
+        const std::uint64_t v = window();
+        m_pos += n;
+        return lowBits(v, n);
+    }
+
+    auto readRice(const int k) -> std::uint64_t
+    {
+        const int q = std::countr_zero(window());
+        m_pos += q + 1;
+        return (q == ESCAPE) ? read(64) : (static_cast<std::uint64_t>(q) << k) | read(k);
+    }
+
+private:
+    [[nodiscard]] auto word(const std::size_t i) const -> std::uint64_t
+    {
+        std::uint64_t w{ 0 };
+        if (i < m_numWords)
+        {
+            std::memcpy(&w, m_data + 8 * i, sizeof(w));
+        }
+        return w;
+    }
+
+    [[nodiscard]] auto window() const -> std::uint64_t
+    {
+        const std::size_t idx = m_pos >> 6;
+        const int off = static_cast<int>(m_pos & 63);
+        const std::uint64_t w0 = word(idx);
+        return (off == 0) ? w0 : (w0 >> off) | (word(idx + 1) << (64 - off));
+    }
+
+private:
+    const char* m_data;
+    std::size_t m_numWords;
+    std::size_t m_pos{ 0 };
+};
+
+// Rice parameter minimizing the coded size of values
+static auto bestRiceParameter(const std::uint64_t* values, const int n) -> int
+{
+    long double mean{ 0.0 };
+    for (int i = 0; i < n; ++i)
+    {
+        mean += values[i];
+    }
+    mean /= n;
+    const int guess = (mean < 1.0L) ? 0 : static_cast<int>(std::log2(mean));
+
+    int best_k{ 0 };
+    std::uint64_t best_bits{ ~std::uint64_t{ 0 } };
+    for (int k = std::max(0, guess - 2); k <= std::min(63, guess + 2); ++k)
+    {
+        std::uint64_t bits{ 0 };
+        for (int i = 0; i < n; ++i)
+        {
+            const std::uint64_t q = values[i] >> k;
+            bits += (q < ESCAPE) ? q + 1 + k : ESCAPE + 1 + 64;
+        }
+        if (bits < best_bits)
+        {
+            best_bits = bits;
+            best_k = k;
+        }
+    }
+    return best_k;
+}
+
+TrajectoryWriter::~TrajectoryWriter()
+{
+    close();
+}
+
+[[maybe_unused]] auto TrajectoryWriter::open(const std::filesystem::path& filename, const TrajectoryMode mode,
+                                             const double& precision_xy, const double& precision_a, const int keyframe_interval) -> bool
+{
+    close();
+
+    m_file.open(filename, std::ios::binary | std::ios::trunc);
+    if (!m_file.is_open())
+    {
+        std::cout << "FILE " << filename << " COULD NOT BE OPENED!\n";
+        return false;
+    }
+
+    m_mode = mode;
+    m_stepXY = (mode == TrajectoryMode::LOSSY) ? 2.0 * precision_xy : 0.0;
+    m_stepA = (mode == TrajectoryMode::LOSSY) ? 2.0 * precision_a : 0.0;
+    m_keyframeInterval = std::max(1, keyframe_interval);
+    m_frames = 0;
+    m_keyframes.clear();
+
+    m_file.write(MAGIC.data(), MAGIC.size());
+    writeRaw(m_file, VERSION);
+    writeRaw(m_file, static_cast<std::uint32_t>(GP::NUM_RODS));
+    writeRaw(m_file, static_cast<std::uint32_t>(m_mode));
+    writeRaw(m_file, m_stepXY);
+    writeRaw(m_file, m_stepA);
+    writeRaw(m_file, static_cast<std::uint32_t>(m_keyframeInterval));
+    writeRaw(m_file, std::uint32_t{ 0 });
+    m_offset = HEADER_BYTES;
+
+    return m_file.good();
+}
+
+[[maybe_unused]] auto TrajectoryWriter::write(const std::array<Rod, GP::NUM_RODS>& rods) -> bool
+{
+    if (!m_file.is_open())
+    {
+        return false;
+    }
+
+    constexpr int N = GP::NUM_RODS;
+    for (int i = 0; i < N; ++i)
+    {
+        const Rod& rod = rods[i];
+        if (m_mode == TrajectoryMode::LOSSY)
+        {
+            m_current[i] = std::llround(rod.x / m_stepXY);
+            m_current[N + i] = std::llround(rod.y / m_stepXY);
+            m_current[2 * N + i] = std::llround(rod.a / m_stepA);
+        }
+        else
+        {
+            m_current[i] = std::bit_cast<std::int64_t>(rod.x);
+            m_current[N + i] = std::bit_cast<std::int64_t>(rod.y);
+            m_current[2 * N + i] = std::bit_cast<std::int64_t>(rod.a);
+        }
+    }
+
+    const bool is_keyframe = (m_frames % m_keyframeInterval == 0);
+    for (int c = 0; c < 3 * N; ++c)
+    {   // Wrapping difference, so that it is exact for any pair of codes
+        const std::uint64_t previous = is_keyframe ? 0 : static_cast<std::uint64_t>(m_previous[c]);
+        m_values[c] = zigzag(static_cast<std::int64_t>(static_cast<std::uint64_t>(m_current[c]) - previous));
+    }
+
+    std::array<std::uint8_t, 3> k{};
+    m_payload.clear();
+    BitWriter bits{ m_payload };
+    for (int channel = 0; channel < 3; ++channel)
+    {
+        k[channel] = static_cast<std::uint8_t>(bestRiceParameter(m_values.data() + channel * N, N));
+        for (int i = 0; i < N; ++i)
+        {
+            bits.writeRice(m_values[channel * N + i], k[channel]);
+        }
+    }
+    bits.flush();
+
+    if (is_keyframe)
+    {
+        m_keyframes.push_back({ m_frames, m_offset });
+    }
+    writeRaw(m_file, static_cast<std::uint32_t>(m_payload.size()));
+    writeRaw(m_file, static_cast<std::uint8_t>(is_keyframe));
+    m_file.write(reinterpret_cast<const char*>(k.data()), k.size());
+    m_file.write(reinterpret_cast<const char*>(m_payload.data()), m_payload.size() * sizeof(std::uint64_t));
+    m_offset += FRAME_HEADER_BYTES + m_payload.size() * sizeof(std::uint64_t);
+
+    std::swap(m_previous, m_current);
+    ++m_frames;
+    return m_file.good();
+}
+
+[[maybe_unused]] auto TrajectoryWriter::close() -> bool
+{
+    if (!m_file.is_open())
+    {
+        return false;
+    }
+
+    for (const Keyframe& key : m_keyframes)
+    {
+        writeRaw(m_file, key.frame);
+        writeRaw(m_file, key.offset);
+    }
+    writeRaw(m_file, m_offset);
+    writeRaw(m_file, static_cast<std::uint32_t>(m_frames));
+    m_file.write(INDEX_MAGIC.data(), INDEX_MAGIC.size());
+
+    const bool good = m_file.good();
+    m_file.close();
+    return good;
+}
+
+[[maybe_unused]] auto TrajectoryReader::open(const std::filesystem::path& filename) -> bool
+{
+    if (!m_file.open(filename))
+    {
+        std::cout << "FILE " << filename << " COULD NOT BE OPENED!\n";
+        return false;
+    }
+    m_data = m_file.view();
+
+    if (m_data.size() < HEADER_BYTES || m_data.substr(0, MAGIC.size()) != MAGIC
+        || readAt<std::uint32_t>(m_data, 4) != VERSION || readAt<std::uint32_t>(m_data, 8) != GP::NUM_RODS)
+    {
+        std::cout << "FILE " << filename << " IS NOT A TRAJECTORY OF " << GP::NUM_RODS << " RODS!\n";
+        return false;
+    }
+    const std::uint32_t mode = readAt<std::uint32_t>(m_data, 12);
+    m_stepXY = readAt<double>(m_data, 16);
+    m_stepA = readAt<double>(m_data, 24);
+    const bool valid_steps = std::isfinite(m_stepXY) && std::isfinite(m_stepA) && m_stepXY > 0.0 && m_stepA > 0.0;
+    if ((mode != static_cast<std::uint32_t>(TrajectoryMode::LOSSLESS) && mode != static_cast<std::uint32_t>(TrajectoryMode::LOSSY))
+        || (mode == static_cast<std::uint32_t>(TrajectoryMode::LOSSY) && !valid_steps))
+    {
+        std::cout << "FILE " << filename << " IS CORRUPTED!\n";
+        return false;
+    }
+    m_mode = static_cast<TrajectoryMode>(mode);
+    m_keyframeInterval = std::max<std::uint32_t>(1, readAt<std::uint32_t>(m_data, 32));
+
+    m_keyframes.clear();
+    const std::size_t size = m_data.size();
+    const bool has_index = (size >= HEADER_BYTES + TRAILER_BYTES && m_data.substr(size - INDEX_MAGIC.size()) == INDEX_MAGIC);
+    if (has_index && readIndex())
+    {
+        return seek(0);
+    }
+    if (has_index)
+    {
+        std::cout << "FILE " << filename << " HAS A CORRUPTED INDEX! Rebuilding it.\n";
+    }
+    if (!buildIndex(has_index ? size - TRAILER_BYTES : size))
+    {
+        std::cout << "FILE " << filename << " IS CORRUPTED!\n";
+        return false;
+    }
+    return seek(0);
+}
+
+[[nodiscard]] auto TrajectoryReader::readIndex() -> bool
+{
+    // Nothing in the trailer is trusted until checked against the file
+    const std::size_t index_end = m_data.size() - TRAILER_BYTES;
+    const std::uint64_t end = readAt<std::uint64_t>(m_data, index_end);
+    const std::uint32_t num_frames = readAt<std::uint32_t>(m_data, index_end + 8);
+    if (end < HEADER_BYTES || end > index_end || (index_end - end) % sizeof(Keyframe) != 0
+        || num_frames > static_cast<std::uint32_t>(std::numeric_limits<int>::max())
+        || (index_end - end) / sizeof(Keyframe) != (num_frames + m_keyframeInterval - 1) / m_keyframeInterval)
+    {
+        return false;
+    }
+
+    std::uint64_t previous{ 0 };
+    for (std::size_t offset = end; offset < index_end; offset += sizeof(Keyframe))
+    {
+        const Keyframe key{ readAt<std::uint64_t>(m_data, offset), readAt<std::uint64_t>(m_data, offset + 8) };
+        if (key.frame != m_keyframes.size() * m_keyframeInterval || key.offset < HEADER_BYTES
+            || key.offset + FRAME_HEADER_BYTES > end || key.offset < previous)
+        {
+            m_keyframes.clear();
+            return false;
+        }
+        previous = key.offset + FRAME_HEADER_BYTES;
+        m_keyframes.push_back(key);
+    }
+    m_end = end;
+    m_numFrames = static_cast<int>(num_frames);
+    return true;
+}
+
+[[nodiscard]] auto TrajectoryReader::buildIndex(const std::size_t limit) -> bool
+{
+    // No valid index (e.g. the run was interrupted): scan frame headers up to the last complete frame before limit
+    m_numFrames = 0;
+    std::size_t offset = HEADER_BYTES;
+    while (offset + FRAME_HEADER_BYTES <= limit)
+    {
+        const std::uint32_t words = readAt<std::uint32_t>(m_data, offset);
+        const std::uint8_t is_keyframe = readAt<std::uint8_t>(m_data, offset + 4);
+        const bool k_valid = readAt<std::uint8_t>(m_data, offset + 5) < 64 && readAt<std::uint8_t>(m_data, offset + 6) < 64
+                          && readAt<std::uint8_t>(m_data, offset + 7) < 64;
+        const std::size_t next = offset + FRAME_HEADER_BYTES + sizeof(std::uint64_t) * words;
+        if (next > limit || words < MIN_PAYLOAD_WORDS || !k_valid || is_keyframe != (m_numFrames % m_keyframeInterval == 0))
+        {   // Incomplete, or not a frame header
+            break;
+        }
+        if (is_keyframe != 0)
+        {
+            m_keyframes.push_back({ static_cast<std::uint64_t>(m_numFrames), offset });
+        }
+        ++m_numFrames;
+        offset = next;
+    }
+    m_end = offset;
+    return !m_keyframes.empty() || m_numFrames == 0;
+}
+
+[[nodiscard]] auto TrajectoryReader::getNumFrames() const -> int
+{
+    return m_numFrames;
+}
+
+[[nodiscard]] auto TrajectoryReader::getMode() const -> TrajectoryMode
+{
+    return m_mode;
+}
+
+[[maybe_unused]] auto TrajectoryReader::seek(const int frame) -> bool
+{
+    if (frame < 0 || frame > m_numFrames)
+    {
+        return false;
+    }
+    if (frame == m_numFrames || m_keyframes.empty())
+    {   // Past the end
+        m_frame = m_numFrames;
+        m_offset = m_end;
+        return true;
+    }
+
+    const auto key = std::ranges::upper_bound(m_keyframes, static_cast<std::uint64_t>(frame), {}, &Keyframe::frame) - 1;
+    m_frame = static_cast<int>(key->frame);
+    m_offset = key->offset;
+    while (m_frame < frame)
+    {
+        if (!decodeFrame())
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+[[nodiscard]] auto TrajectoryReader::decodeFrame() -> bool
+{
+    if (m_frame >= m_numFrames || m_offset + FRAME_HEADER_BYTES > m_end)
+    {
+        return false;
+    }
+    const std::size_t num_words = readAt<std::uint32_t>(m_data, m_offset);
+    const bool is_keyframe = readAt<std::uint8_t>(m_data, m_offset + 4) != 0;
+    const std::size_t payload = m_offset + FRAME_HEADER_BYTES;
+    if (payload + sizeof(std::uint64_t) * num_words > m_end)
+    {
+        return false;
+    }
+
+    constexpr int N = GP::NUM_RODS;
+    BitReader bits{ m_data.data() + payload, num_words };
+    for (int channel = 0; channel < 3; ++channel)
+    {
+        const int k = readAt<std::uint8_t>(m_data, m_offset + 5 + channel);
+        std::int64_t* codes = m_codes.data() + channel * N;
+        for (int i = 0; i < N; ++i)
+        {
+            const std::uint64_t previous = is_keyframe ? 0 : static_cast<std::uint64_t>(codes[i]);
+            codes[i] = static_cast<std::int64_t>(previous + static_cast<std::uint64_t>(unzigzag(bits.readRice(k))));
+        }
+    }
+
+    m_offset = payload + sizeof(std::uint64_t) * num_words;
+    ++m_frame;
+    return true;
+}
+
+[[maybe_unused]] auto TrajectoryReader::read(std::array<Rod, GP::NUM_RODS>& rods) -> bool
+{
+    if (!decodeFrame())
+    {
+        return false;
+    }
+
+    constexpr int N = GP::NUM_RODS;
+    for (int i = 0; i < N; ++i)
+    {
+        Rod& rod = rods[i];
+        if (m_mode == TrajectoryMode::LOSSY)
+        {
+            rod.x = m_codes[i] * m_stepXY;
+            rod.y = m_codes[N + i] * m_stepXY;
+            rod.a = m_codes[2 * N + i] * m_stepA;
+        }
+        else
+        {
+            rod.x = std::bit_cast<double>(m_codes[i]);
+            rod.y = std::bit_cast<double>(m_codes[N + i]);
+            rod.a = std::bit_cast<double>(m_codes[2 * N + i]);
+        }
+        rod.index = i;
+    }
+    return true;
+}
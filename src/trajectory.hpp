@@ -0,0 +1,97 @@
+#pragma once
+
+#include "GlobalParameters.hpp" // includes <cmath>, <numbers> and <filesystem>
+#include "rod.hpp"
+#include "csvLoader.hpp"
+#include <array>
+#include <cstdint>
+#include <fstream>
+#include <vector>
+
+/* Archival trajectory format.
+	Every frame stores, per coordinate (x, y, a), the difference of each rod's integer code with
+	respect to the previous frame, Rice-coded with the parameter that minimizes the frame size.
+	Keyframes store differences with respect to zero, so decoding can start at any of them.
+	- LOSSY:    codes are round(value / (2 * precision)), so every value is recovered within precision.
+	- LOSSLESS: codes are the bit patterns of the doubles, so every value is recovered exactly.
+
+	File layout (native byte order, 8-byte aligned):
+	- Header:  char[4] "ACTR", uint32 version, uint32 num_rods, uint32 mode,
+	           float64 step_xy, float64 step_a, uint32 keyframe_interval, uint32 0
+	- Frame:   uint32 payload_words, uint8 is_keyframe, uint8 k_x, uint8 k_y, uint8 k_a, uint64 payload[payload_words]
+	- Index:   {uint64 frame, uint64 offset} per keyframe,
+	           then uint64 index_offset, uint32 num_frames, char[4] "ACTI"
+	The index is written by close(). Files without it, or whose index does not match the frames,
+	can still be read, at the cost of a scan on open().
+ */
+enum class TrajectoryMode : std::uint32_t {
+	LOSSLESS,
+	LOSSY
+};
+
+struct Keyframe {
+	std::uint64_t frame;
+	std::uint64_t offset;
+};
+
+class TrajectoryWriter {
+public:
+	TrajectoryWriter() = default;
+	TrajectoryWriter(const TrajectoryWriter&) = delete;
+	TrajectoryWriter& operator=(const TrajectoryWriter&) = delete;
+	~TrajectoryWriter();
+
+	[[maybe_unused]] auto open(const std::filesystem::path& filename,
+	                           const TrajectoryMode mode = TrajectoryMode::LOSSY,
+	                           const double& precision_xy = GP::TRAJECTORY::PRECISION_XY,
+	                           const double& precision_a = GP::TRAJECTORY::PRECISION_A,
+	                           const int keyframe_interval = GP::TRAJECTORY::KEYFRAME_INTERVAL) -> bool;
+	[[maybe_unused]] auto write(const std::array<Rod, GP::NUM_RODS>& rods) -> bool;
+	[[maybe_unused]] auto close() -> bool;
+
+private:
+	std::ofstream m_file{};
+	TrajectoryMode m_mode{ TrajectoryMode::LOSSY };
+	double m_stepXY{ 0.0 };
+	double m_stepA{ 0.0 };
+	int m_keyframeInterval{ 1 };
+	std::uint64_t m_frames{ 0 };
+	std::uint64_t m_offset{ 0 };
+	std::vector<Keyframe> m_keyframes{};
+	std::vector<std::int64_t> m_previous = std::vector<std::int64_t>(3 * GP::NUM_RODS);
+	std::vector<std::int64_t> m_current = std::vector<std::int64_t>(3 * GP::NUM_RODS);
+	std::vector<std::uint64_t> m_values = std::vector<std::uint64_t>(3 * GP::NUM_RODS);
+	std::vector<std::uint64_t> m_payload{};
+};
+
+class TrajectoryReader {
+public:
+	[[maybe_unused]] auto open(const std::filesystem::path& filename) -> bool;
+
+	[[nodiscard]] auto getNumFrames() const -> int;
+	[[nodiscard]] auto getMode() const -> TrajectoryMode;
+
+	/* Positions the reader so that the next read() returns the given frame. */
+	[[maybe_unused]] auto seek(const int frame) -> bool;
+	/* Decodes the next frame into rods. Returns false at the end of the trajectory. */
+	[[maybe_unused]] auto read(std::array<Rod, GP::NUM_RODS>& rods) -> bool;
+
+private:
+	[[nodiscard]] auto readIndex() -> bool;
+	[[nodiscard]] auto buildIndex(const std::size_t limit) -> bool;
+	[[nodiscard]] auto decodeFrame() -> bool;
+
+private:
+	MappedFile m_file{};
+	std::string_view m_data{};
+	TrajectoryMode m_mode{ TrajectoryMode::LOSSY };
+	double m_stepXY{ 0.0 };
+	double m_stepA{ 0.0 };
+	std::uint32_t m_keyframeInterval{ 1 };
+	std::uint64_t m_end{ 0 }; // End of the frames
+	std::uint64_t m_offset{ 0 };
+	int m_frame{ 0 };
+	int m_numFrames{ 0 };
+	std::vector<Keyframe> m_keyframes{};
+	std::vector<std::int64_t> m_codes = std::vector<std::int64_t>(3 * GP::NUM_RODS);
+};